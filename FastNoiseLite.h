@@ -394,6 +394,9 @@ public:
     }
 
 private:
+    // noise_batch.h evaluates whole arrays of coordinates with these settings and tables
+    friend struct FastNoiseBatch;
+
     template <typename T>
     struct Arguments_must_be_floating_point_values;
 
@@ -1,14 +1,88 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
-#include <string>
 #include <vector>
 #include <array>
+#include <charconv>
 #include <cstring>
-#include <algorithm>
+#include <filesystem>
 #include "glm/glm.hpp"
+#include "mapped_file.h"
 #include "ObjLoader.h"
 
+// The whole file is mapped and scanned in place: no std::string or stream per
+// line, numbers go through std::from_chars.
+
+namespace {
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+const char* skipToken(const char* p, const char* end) {
+    while (p < end && !isBlank(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+// Reads up to count floats; the missing ones are left as they are
+void parseFloats(const char* p, const char* end, float* values, int count) {
+    for (int i = 0; i < count; ++i) {
+        p = skipBlanks(p, end);
+        if (p < end && *p == '+') {
+            ++p;  // from_chars does not take a leading '+'
+        }
+        auto [next, error] = std::from_chars(p, end, values[i]);
+        if (error != std::errc()) {
+            return;
+        }
+        p = next;
+    }
+}
+
+// 1-based, or negative counting back from the last element read so far;
+// -1 when the index is missing or out of range
+int resolveIndex(const char*& p, const char* end, size_t count) {
+    int index = 0;
+    auto [next, error] = std::from_chars(p, end, index);
+    if (error != std::errc()) {
+        return -1;
+    }
+    p = next;
+    long long resolved = index > 0 ? index - 1LL : static_cast<long long>(count) + index;
+    return index != 0 && resolved >= 0 && resolved < static_cast<long long>(count) ? static_cast<int>(resolved) : -1;
+}
+
+struct Corner {
+    int vertex;
+    int tex;
+    int normal;
+};
+
+// v, v/vt, v//vn or v/vt/vn
+Corner parseCorner(const char* p, const char* end, size_t vertexCount, size_t texCount, size_t normalCount) {
+    Corner corner = {resolveIndex(p, end, vertexCount), -1, -1};
+    if (p < end && *p == '/') {
+        ++p;
+        if (p < end && *p != '/') {
+            corner.tex = resolveIndex(p, end, texCount);
+        }
+        if (p < end && *p == '/') {
+            ++p;
+            corner.normal = resolveIndex(p, end, normalCount);
+        }
+    }
+    return corner;
+}
+
+}  // namespace
+
 bool loadOBJ(
     const char* path,
     std::vector<glm::vec3>& out_vertices,
@@ -17,58 +91,88 @@ bool loadOBJ(
     std::vector<Face>& out_faces
 )
 {
-    std::ifstream file(path);
-    if (!file)
+    MappedFile file;
+    if (!file.open(path))
     {
+        // An empty file cannot be mapped, but it is a valid OBJ with nothing in it
+        std::error_code error;
+        if (std::filesystem::is_regular_file(path, error) && std::filesystem::file_size(path, error) == 0 && !error)
+        {
+            return true;
+        }
         std::cout << "Failed to open the file: " << path << std::endl;
         return false;
     }
 
-    std::string line;
-    while (std::getline(file, line))
+    const char* p = reinterpret_cast<const char*>(file.data());
+    const char* end = p + file.size();
+    while (p < end)
     {
-        std::istringstream iss(line);
-        std::string lineHeader;
-        iss >> lineHeader;
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!lineEnd)
+        {
+            lineEnd = end;
+        }
+
+        const char* header = skipBlanks(p, lineEnd);
+        const char* headerEnd = skipToken(header, lineEnd);
+        size_t headerLength = headerEnd - header;
 
-        if (lineHeader == "v")
+        if (headerLength == 1 && header[0] == 'v')
         {
-            glm::vec3 vertex;
-            iss >> vertex.x >> vertex.y >> vertex.z;
+            glm::vec3 vertex(0.0f);
+            parseFloats(headerEnd, lineEnd, &vertex.x, 3);
             out_vertices.push_back(vertex);
         }
-        else if (lineHeader == "vn")
+        else if (headerLength == 2 && header[0] == 'v' && header[1] == 'n')
         {
-            glm::vec3 normal;
-            iss >> normal.x >> normal.y >> normal.z;
+            glm::vec3 normal(0.0f);
+            parseFloats(headerEnd, lineEnd, &normal.x, 3);
             out_normals.push_back(normal);
         }
-        else if (lineHeader == "vt")
+        else if (headerLength == 2 && header[0] == 'v' && header[1] == 't')
         {
-            glm::vec3 tex;
-            iss >> tex.x >> tex.y >> tex.z;
+            glm::vec3 tex(0.0f);
+            parseFloats(headerEnd, lineEnd, &tex.x, 3);
             out_texcoords.push_back(tex);
         }
-        else if (lineHeader == "f")
+        else if (headerLength == 1 && header[0] == 'f')
         {
-            Face face;
-            for (int i = 0; i < 3; ++i)
+            // Polygons with more than three corners become a fan around the first one
+            Corner first = {};
+            Corner previous = {};
+            int corners = 0;
+            bool valid = true;
+            const char* q = skipBlanks(headerEnd, lineEnd);
+            while (q < lineEnd)
             {
-                std::string faceData;
-                iss >> faceData;
-
-                std::replace(faceData.begin(), faceData.end(), '/', ' ');
-
-                std::istringstream faceDataIss(faceData);
-                faceDataIss >> face.vertexIndices[i] >> face.texIndices[i] >> face.normalIndices[i];
-
-                // obj indices are 1-based, so convert to 0-based
-                face.vertexIndices[i]--;
-                face.normalIndices[i]--;
-                face.texIndices[i]--;
+                const char* cornerEnd = skipToken(q, lineEnd);
+                Corner corner = parseCorner(q, cornerEnd, out_vertices.size(), out_texcoords.size(), out_normals.size());
+                valid = valid && corner.vertex >= 0;
+                if (corners >= 2)
+                {
+                    Face face;
+                    face.vertexIndices = {first.vertex, previous.vertex, corner.vertex};
+                    face.texIndices = {first.tex, previous.tex, corner.tex};
+                    face.normalIndices = {first.normal, previous.normal, corner.normal};
+                    out_faces.push_back(face);
+                }
+                else if (corners == 0)
+                {
+                    first = corner;
+                }
+                previous = corner;
+                ++corners;
+                q = skipBlanks(cornerEnd, lineEnd);
+            }
+            // A face that refers to a vertex that does not exist is dropped whole
+            if (!valid && corners >= 3)
+            {
+                out_faces.resize(out_faces.size() - (corners - 2));
             }
-            out_faces.push_back(face);
         }
+
+        p = lineEnd + 1;
     }
 
     return true;
@@ -3,6 +3,8 @@
 #include <vector>
 #include "glm/glm.hpp"
 
+// 0-based indices; texIndices and normalIndices are -1 when the face does not
+// give them (v, v/vt or v//vn corners)
 struct Face
 {
   std::array<int, 3> vertexIndices;
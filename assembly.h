@@ -0,0 +1,198 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "fragment.h"
+#include "mesh.h"
+#include "triangle.h"
+
+// Primitive assembly: turns the triangles of a mesh, with its vertices already
+// through the vertex stage, into the list of screen-space triangles the tiles
+// rasterize. Triangles outside the view volume are dropped, triangles crossing
+// the near or far plane (or far outside the screen) are clipped in clip space,
+// and back-facing and zero-area ones are culled.
+
+// Which triangles are dropped by their winding on screen. The planets are
+// closed meshes wound counter-clockwise (seen from outside), so with BACK the
+// triangles on their far side never reach the rasterizer.
+enum class CullMode {
+    NONE,
+    BACK,
+    FRONT
+};
+
+CullMode cullMode = CullMode::BACK;
+
+// Twice the signed area on the same 1/16 pixel grid triangle() snaps to, so a
+// triangle is dropped here exactly when it could not cover a pixel there
+// either. Positive when counter-clockwise in the y-up NDC convention (the
+// viewport does not flip y).
+bool isCulled(const glm::vec3& A, const glm::vec3& B, const glm::vec3& C) {
+    if (!isSnappable(A) || !isSnappable(B) || !isSnappable(C)) {
+        return false;  // left to the bounds test and setupTriangle()
+    }
+    SnappedVertex sa = snapVertex(A);
+    SnappedVertex sb = snapVertex(B);
+    SnappedVertex sc = snapVertex(C);
+    int64_t area = edgeFunction(sa, sb, sc.x, sc.y);
+    if (area == 0) {
+        return true;
+    }
+    return (cullMode == CullMode::BACK && area < 0) || (cullMode == CullMode::FRONT && area > 0);
+}
+
+// Sides are not clipped to the screen, only to a band this many times wider
+// (in NDC), which keeps the snapped coordinates well inside the rasterizer's
+// fixed-point range. Between the screen and the band, the bounding boxes are
+// clamped to the tiles instead.
+constexpr float GUARD_BAND = 16.0f;
+
+// Signed distances to the clip planes, positive inside. The first six form the
+// view volume (-w <= x, y, z <= w); the near and far planes and the guard band
+// are the ones triangles get clipped against.
+enum ClipPlane {
+    CLIP_LEFT,
+    CLIP_RIGHT,
+    CLIP_BOTTOM,
+    CLIP_TOP,
+    CLIP_NEAR,
+    CLIP_FAR,
+    GUARD_LEFT,
+    GUARD_RIGHT,
+    GUARD_BOTTOM,
+    GUARD_TOP,
+    CLIP_PLANE_COUNT
+};
+
+constexpr uint32_t VIEW_VOLUME_PLANES = 0x3F;
+constexpr uint32_t CLIPPED_PLANES = (1u << CLIP_NEAR) | (1u << CLIP_FAR) | (1u << GUARD_LEFT) |
+                                    (1u << GUARD_RIGHT) | (1u << GUARD_BOTTOM) | (1u << GUARD_TOP);
+
+float clipDistance(const glm::vec4& p, int plane) {
+    switch (plane) {
+        case CLIP_LEFT: return p.w + p.x;
+        case CLIP_RIGHT: return p.w - p.x;
+        case CLIP_BOTTOM: return p.w + p.y;
+        case CLIP_TOP: return p.w - p.y;
+        case CLIP_NEAR: return p.w + p.z;
+        case CLIP_FAR: return p.w - p.z;
+        case GUARD_LEFT: return GUARD_BAND * p.w + p.x;
+        case GUARD_RIGHT: return GUARD_BAND * p.w - p.x;
+        case GUARD_BOTTOM: return GUARD_BAND * p.w + p.y;
+        default: return GUARD_BAND * p.w - p.y;
+    }
+}
+
+// Bit per plane the point is outside of
+uint32_t clipOutcode(const glm::vec4& p) {
+    uint32_t outcode = 0;
+    for (int plane = 0; plane < CLIP_PLANE_COUNT; ++plane) {
+        if (clipDistance(p, plane) < 0.0f) {
+            outcode |= 1u << plane;
+        }
+    }
+    return outcode;
+}
+
+// The point t of the way from a to b. Attributes are interpolated linearly in
+// clip space and the screen position comes from the interpolated clip position.
+Vertex clipLerp(const Vertex& a, const Vertex& b, float t, const glm::mat4& viewport) {
+    Vertex vertex;
+    vertex.clipPos = a.clipPos + (b.clipPos - a.clipPos) * t;
+    vertex.normal = a.normal + (b.normal - a.normal) * t;
+    vertex.tex = a.tex + (b.tex - a.tex) * t;
+    vertex.worldPos = a.worldPos + (b.worldPos - a.worldPos) * t;
+    vertex.originalPos = a.originalPos + (b.originalPos - a.originalPos) * t;
+    glm::vec3 ndc = glm::vec3(vertex.clipPos) / vertex.clipPos.w;
+    vertex.position = glm::vec3(viewport * glm::vec4(ndc, 1.0f));
+    return vertex;
+}
+
+// Sutherland-Hodgman against every plane in planes. A triangle gains at most
+// one corner per plane.
+constexpr int MAX_CLIPPED_CORNERS = 3 + 6;
+
+int clipPolygon(Vertex* polygon, int count, uint32_t planes, const glm::mat4& viewport) {
+    Vertex clipped[MAX_CLIPPED_CORNERS];
+    for (int plane = 0; plane < CLIP_PLANE_COUNT && count > 0; ++plane) {
+        if (!(planes & (1u << plane))) {
+            continue;
+        }
+        int clippedCount = 0;
+        for (int i = 0; i < count; ++i) {
+            const Vertex& current = polygon[i];
+            const Vertex& next = polygon[(i + 1) % count];
+            float currentDistance = clipDistance(current.clipPos, plane);
+            float nextDistance = clipDistance(next.clipPos, plane);
+            if (currentDistance >= 0.0f) {
+                clipped[clippedCount++] = current;
+            }
+            if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+                float t = currentDistance / (currentDistance - nextDistance);
+                clipped[clippedCount++] = clipLerp(current, next, t, viewport);
+            }
+        }
+        count = clippedCount;
+        for (int i = 0; i < count; ++i) {
+            polygon[i] = clipped[i];
+        }
+    }
+    return count;
+}
+
+// Appends three vertex indices per triangle to triangles. Vertices created by
+// clipping are appended to vertices. Returns how many triangles of the mesh
+// were dropped whole (outside, culled or clipped away).
+size_t assembleTriangles(const Mesh& mesh, const glm::mat4& viewport,
+                         std::vector<Vertex>& vertices, std::vector<uint32_t>& triangles) {
+    // Once per vertex, not per corner; kept across calls so it is only allocated once
+    static std::vector<uint32_t> vertexOutcodes;
+    vertexOutcodes.resize(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        vertexOutcodes[v] = clipOutcode(vertices[v].clipPos);
+    }
+
+    triangles.clear();
+    size_t dropped = 0;
+    size_t triangleCount = mesh.triangleCount();
+    for (size_t i = 0; i < triangleCount; ++i) {
+        uint32_t corners[3] = { mesh.corner(i, 0), mesh.corner(i, 1), mesh.corner(i, 2) };
+        uint32_t outcodes[3] = { vertexOutcodes[corners[0]], vertexOutcodes[corners[1]], vertexOutcodes[corners[2]] };
+
+        // Entirely outside one side of the view volume
+        if (outcodes[0] & outcodes[1] & outcodes[2] & VIEW_VOLUME_PLANES) {
+            dropped++;
+            continue;
+        }
+
+        // The common case: nothing to clip, the vertex stage already projected it
+        uint32_t crossed = (outcodes[0] | outcodes[1] | outcodes[2]) & CLIPPED_PLANES;
+        if (!crossed) {
+            if (isCulled(vertices[corners[0]].position, vertices[corners[1]].position, vertices[corners[2]].position)) {
+                dropped++;
+                continue;
+            }
+            triangles.insert(triangles.end(), corners, corners + 3);
+            continue;
+        }
+
+        // The clipped polygon keeps the winding of the triangle, so it is a fan
+        Vertex polygon[MAX_CLIPPED_CORNERS] = { vertices[corners[0]], vertices[corners[1]], vertices[corners[2]] };
+        int count = clipPolygon(polygon, 3, crossed, viewport);
+        uint32_t first = static_cast<uint32_t>(vertices.size());
+        size_t emitted = 0;
+        for (int k = 1; k + 1 < count; ++k) {
+            if (isCulled(polygon[0].position, polygon[k].position, polygon[k + 1].position)) {
+                continue;
+            }
+            triangles.insert(triangles.end(), { first, first + k, first + k + 1 });
+            emitted++;
+        }
+        if (emitted) {
+            vertices.insert(vertices.end(), polygon, polygon + count);
+        } else {
+            dropped++;
+        }
+    }
+    return dropped;
+}
@@ -0,0 +1,322 @@
+#pragma once
+#include <SDL.h>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+#include "glm/glm.hpp"
+#include "glm/gtc/constants.hpp"
+#include "color.h"
+#include "fragment.h"
+#include "mapped_file.h"
+#include "noise.h"
+#include "shaders.h"
+#include "threadpool.h"
+#include "trace.h"
+#include "uniforms.h"
+
+// Baked planet surfaces. The planet shaders only depend on the fragment's
+// position on the model (and the light intensity, applied afterwards), so
+// their unlit color is evaluated once per texel of an equirectangular texture
+// and the fragment shader becomes one bilinear fetch. The shaders read the
+// model-space position as is, so the texels are evaluated on the bounding
+// sphere of the mesh the planets are drawn with (sphere.obj has radius 0.5 and
+// is not centered on the origin), not on the unit sphere.
+//
+// Texel (x, y) holds the direction from the sphere's center with azimuth atan2(dir.x, dir.z) = (u - 0.5) * 2pi
+// and polar angle acos(dir.y) = v * pi, where u and v are the texel center in [0, 1].
+//
+// Baked textures are kept in a cache directory between runs and mapped back
+// into memory at startup, so the noise is only evaluated again when a shader
+// version, the resolution or the mesh's bounding sphere change.
+
+// The texels live either in storage (just baked) or in a mapped cache file,
+// and are sampled in place in both cases.
+struct BakedTexture {
+    int width = 0;
+    int height = 0;
+    const Uint32* texels = nullptr;  // ARGB8888, row 0 is the north pole (+y)
+    std::vector<Uint32> storage;
+    MappedFile mapping;
+
+    bool empty() const {
+        return texels == nullptr;
+    }
+};
+
+bool bakedShading = true;
+int bakeWidth = 1024;  // the height is half of it
+std::string bakeCacheDirectory = "bake_cache";  // empty: always bake, never write
+// Bounding sphere of the planet mesh, set from Mesh::boundsCenter and boundsRadius
+glm::vec3 bakeSurfaceCenter = glm::vec3(0.0f);
+float bakeSurfaceRadius = 0.5f;
+
+// Indexed by ObjectType; empty for objects without a baked surface
+std::array<BakedTexture, static_cast<size_t>(ObjectType::SPACESHIP) + 1> bakedSurfaces;
+
+// Unlit surface color of a planet at a direction, on the bounding sphere of
+// the planet mesh. Returns false for objects that are not baked: the animated
+// fragmentShader() depends on the frame, and shadeFragment() does not run a
+// shader for Saturn.
+bool evaluateSurface(ObjectType type, const glm::vec3& direction, Color& color) {
+    Fragment fragment{};
+    fragment.color = Color(255, 255, 255);
+    fragment.intensity = 1.0f;
+    fragment.worldPos = bakeSurfaceCenter + direction * bakeSurfaceRadius;
+    fragment.originalPos = fragment.worldPos;
+
+    switch (type) {
+        case ObjectType::SOL: fragmentShaderSun(fragment, shaderNoise.sun); break;
+        case ObjectType::MARS: fragmentShaderMars(fragment, shaderNoise.mars); break;
+        case ObjectType::EARTH: fragmentShaderEarth(fragment, shaderNoise.earth); break;
+        case ObjectType::VENUS: fragmentShaderVenus(fragment, shaderNoise.venus); break;
+        default: return false;
+    }
+    color = fragment.color;
+    return true;
+}
+
+// The *_SHADER_VERSION of the shader evaluateSurface() runs for the object
+uint32_t surfaceShaderVersion(ObjectType type) {
+    switch (type) {
+        case ObjectType::SOL: return SUN_SHADER_VERSION;
+        case ObjectType::MARS: return MARS_SHADER_VERSION;
+        case ObjectType::EARTH: return EARTH_SHADER_VERSION;
+        case ObjectType::VENUS: return VENUS_SHADER_VERSION;
+        default: return 0;
+    }
+}
+
+glm::vec3 texelDirection(int x, int y, int width, int height) {
+    float azimuth = ((x + 0.5f) / width - 0.5f) * glm::two_pi<float>();
+    float polar = (y + 0.5f) / height * glm::pi<float>();
+    return glm::vec3(std::sin(polar) * std::sin(azimuth), std::cos(polar), std::sin(polar) * std::cos(azimuth));
+}
+
+// Bakes one surface; rows are spread over the pool
+bool bakeSurface(ObjectType type, int width, int height, ThreadPool& pool, BakedTexture& texture) {
+    Color probe;
+    if (!evaluateSurface(type, glm::vec3(0.0f, 1.0f, 0.0f), probe)) {
+        return false;
+    }
+
+    texture.width = width;
+    texture.height = height;
+    texture.storage.resize(static_cast<size_t>(width) * height);
+    pool.parallelFor(height, [&](size_t y) {
+        for (int x = 0; x < width; ++x) {
+            Color color;
+            evaluateSurface(type, texelDirection(x, static_cast<int>(y), width, height), color);
+            texture.storage[y * width + x] = color.toARGB();
+        }
+    });
+    texture.texels = texture.storage.data();
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Cache files
+//
+// One file per surface: a 64-byte header followed by the texels, row by row,
+// in native byte order. The header holds the key the file was baked with; a
+// file whose key differs from the current one is baked again and replaced.
+
+constexpr char BAKE_CACHE_MAGIC[4] = {'S', 'P', 'B', 'K'};
+constexpr uint32_t BAKE_CACHE_VERSION = 3;  // bump when the layout changes
+constexpr uint32_t BAKE_CACHE_TEXEL_OFFSET = 64;
+
+struct BakeCacheKey {
+    uint32_t shaderId;  // ObjectType
+    uint32_t shaderVersion;
+    uint32_t width;
+    uint32_t height;
+    uint64_t paramsHash;
+    glm::vec3 surfaceCenter;
+    float surfaceRadius;
+};
+
+struct BakeCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t shaderId;
+    uint32_t shaderVersion;
+    uint32_t width;
+    uint32_t height;
+    uint32_t texelOffset;
+    uint64_t paramsHash;
+    float surfaceCenter[3];
+    float surfaceRadius;
+};
+static_assert(sizeof(BakeCacheHeader) <= BAKE_CACHE_TEXEL_OFFSET, "the texels start after the header");
+
+// A second check behind the shader version, for edits that forget to bump it:
+// the surface color at a fixed set of directions (a Fibonacci sphere). The
+// shaders only output two or three flat colors, so a small change to a
+// frequency, threshold or offset can leave every probe as it was; the
+// version is what invalidates the cache, the hash only catches the rest.
+uint64_t surfaceParamsHash(ObjectType type) {
+    constexpr int PROBES = 256;
+    uint64_t hash = 14695981039346656037ull;  // FNV-1a
+    auto mix = [&](uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 1099511628211ull;
+        }
+    };
+    for (int i = 0; i < PROBES; ++i) {
+        float y = 1.0f - (i + 0.5f) * 2.0f / PROBES;
+        float radius = std::sqrt(1.0f - y * y);
+        float angle = i * 2.39996323f;  // golden angle
+        Color color;
+        if (!evaluateSurface(type, glm::vec3(radius * std::sin(angle), y, radius * std::cos(angle)), color)) {
+            return 0;
+        }
+        mix(color.toARGB());
+    }
+    return hash;
+}
+
+std::filesystem::path bakeCachePath(const BakeCacheKey& key) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "surface_%u_%ux%u.bake", key.shaderId, key.width, key.height);
+    return std::filesystem::path(bakeCacheDirectory) / name;
+}
+
+// Maps a cache file and points the texture at its texels. False when the
+// file is missing, truncated or was baked with a different key.
+bool loadBakeCache(const BakeCacheKey& key, BakedTexture& texture) {
+    MappedFile file;
+    if (!file.open(bakeCachePath(key).string()) || file.size() < BAKE_CACHE_TEXEL_OFFSET) {
+        return false;
+    }
+
+    BakeCacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    size_t texelBytes = static_cast<size_t>(key.width) * key.height * sizeof(Uint32);
+    if (std::memcmp(header.magic, BAKE_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != BAKE_CACHE_VERSION || header.shaderId != key.shaderId ||
+        header.shaderVersion != key.shaderVersion || header.width != key.width ||
+        header.height != key.height || header.paramsHash != key.paramsHash ||
+        header.surfaceCenter[0] != key.surfaceCenter.x || header.surfaceCenter[1] != key.surfaceCenter.y ||
+        header.surfaceCenter[2] != key.surfaceCenter.z || header.surfaceRadius != key.surfaceRadius ||
+        header.texelOffset != BAKE_CACHE_TEXEL_OFFSET || file.size() < BAKE_CACHE_TEXEL_OFFSET + texelBytes) {
+        return false;
+    }
+
+    texture.width = static_cast<int>(key.width);
+    texture.height = static_cast<int>(key.height);
+    texture.storage.clear();
+    texture.texels = reinterpret_cast<const Uint32*>(file.data() + BAKE_CACHE_TEXEL_OFFSET);
+    texture.mapping = std::move(file);
+    return true;
+}
+
+// Through writeFileAtomically(), so an interrupted run or another process
+// writing the same surface never leaves a torn file under the final name
+bool writeBakeCache(const BakeCacheKey& key, const BakedTexture& texture) {
+    unsigned char block[BAKE_CACHE_TEXEL_OFFSET] = {};
+    BakeCacheHeader header{};
+    std::memcpy(header.magic, BAKE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = BAKE_CACHE_VERSION;
+    header.shaderId = key.shaderId;
+    header.shaderVersion = key.shaderVersion;
+    header.width = key.width;
+    header.height = key.height;
+    header.texelOffset = BAKE_CACHE_TEXEL_OFFSET;
+    header.paramsHash = key.paramsHash;
+    header.surfaceCenter[0] = key.surfaceCenter.x;
+    header.surfaceCenter[1] = key.surfaceCenter.y;
+    header.surfaceCenter[2] = key.surfaceCenter.z;
+    header.surfaceRadius = key.surfaceRadius;
+    std::memcpy(block, &header, sizeof(header));
+
+    size_t texelCount = static_cast<size_t>(texture.width) * texture.height;
+    return writeFileAtomically(bakeCachePath(key), [&](FILE* file) {
+        return std::fwrite(block, sizeof(block), 1, file) == 1 &&
+               std::fwrite(texture.texels, sizeof(Uint32), texelCount, file) == texelCount;
+    });
+}
+
+// Loads every planet with a static surface from the cache, baking (and
+// caching) the ones that are missing or out of date. Needs setupNoise() and
+// the mesh's bounding sphere first.
+// Returns how many surfaces had to be baked.
+size_t bakePlanetSurfaces(ThreadPool& pool) {
+    TRACE_SCOPE("bake");
+    size_t baked = 0;
+    for (size_t i = 0; i < bakedSurfaces.size(); ++i) {
+        ObjectType type = static_cast<ObjectType>(i);
+        BakedTexture& texture = bakedSurfaces[i];
+        texture = BakedTexture();
+
+        uint64_t paramsHash = surfaceParamsHash(type);
+        if (paramsHash == 0) {
+            continue;  // not baked
+        }
+        BakeCacheKey key{static_cast<uint32_t>(i), surfaceShaderVersion(type), static_cast<uint32_t>(bakeWidth),
+                         static_cast<uint32_t>(bakeWidth / 2), paramsHash, bakeSurfaceCenter, bakeSurfaceRadius};
+        bool cached = !bakeCacheDirectory.empty();
+        if (cached && loadBakeCache(key, texture)) {
+            continue;
+        }
+
+        bakeSurface(type, bakeWidth, bakeWidth / 2, pool, texture);
+        baked++;
+        if (cached) {
+            writeBakeCache(key, texture);
+        }
+    }
+    return baked;
+}
+
+// Bilinear fetch; wraps around in azimuth and clamps at the poles
+Color sampleBaked(const BakedTexture& texture, const glm::vec3& position) {
+    float length = glm::length(position);
+    if (!(length > 0.0f)) {
+        length = 1.0f;
+    }
+    float polar = std::acos(glm::clamp(position.y / length, -1.0f, 1.0f));
+    float azimuth = std::atan2(position.x, position.z);
+
+    float u = (azimuth / glm::two_pi<float>() + 0.5f) * texture.width - 0.5f;
+    float v = polar / glm::pi<float>() * texture.height - 0.5f;
+    float fu = std::floor(u);
+    float fv = std::floor(v);
+    float tu = u - fu;
+    float tv = v - fv;
+
+    int x0 = static_cast<int>(fu);
+    int y0 = static_cast<int>(fv);
+    int x1 = x0 + 1;
+    int y1 = y0 + 1;
+    x0 = (x0 % texture.width + texture.width) % texture.width;
+    x1 = (x1 % texture.width + texture.width) % texture.width;
+    y0 = glm::clamp(y0, 0, texture.height - 1);
+    y1 = glm::clamp(y1, 0, texture.height - 1);
+
+    Uint32 c00 = texture.texels[y0 * texture.width + x0];
+    Uint32 c10 = texture.texels[y0 * texture.width + x1];
+    Uint32 c01 = texture.texels[y1 * texture.width + x0];
+    Uint32 c11 = texture.texels[y1 * texture.width + x1];
+
+    auto channel = [&](int shift) {
+        float top = ((c00 >> shift) & 0xFF) * (1.0f - tu) + ((c10 >> shift) & 0xFF) * tu;
+        float bottom = ((c01 >> shift) & 0xFF) * (1.0f - tu) + ((c11 >> shift) & 0xFF) * tu;
+        return static_cast<int>(top * (1.0f - tv) + bottom * tv + 0.5f);
+    };
+    return Color(channel(16), channel(8), channel(0), channel(24));
+}
+
+// Shades the fragment from its baked surface, if the object has one
+bool shadeBaked(Fragment& fragment, ObjectType type) {
+    const BakedTexture& texture = bakedSurfaces[static_cast<size_t>(type)];
+    if (!bakedShading || texture.empty()) {
+        return false;
+    }
+    fragment.color = sampleBaked(texture, fragment.originalPos - bakeSurfaceCenter) * fragment.intensity;
+    return true;
+}
@@ -0,0 +1,777 @@
+// Benchmarks for the software renderer. Build the `bench` target and run it
+// from the build directory, like the main executable:
+//
+//   bench                 every benchmark
+//   bench shader          only the ones whose name contains "shader"
+//   bench --runs 31 frame more samples per benchmark
+//
+// Every benchmark is run a number of times on the same fixed input and
+// reports the median, mean, standard deviation and minimum per operation, so
+// two builds can be compared run against run.
+//
+// noise/verify and vertex/verify are checks rather than benchmarks: they
+// compare the SIMD kernels with the scalar code they replace, and bench exits
+// with 1 when the two differ.
+#include <SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include "color.h"
+#include "fragment.h"
+#include "framebuffer.h"
+#include "noise_batch.h"
+#include "presenter.h"
+#include "scene.h"
+
+using BenchClock = std::chrono::steady_clock;
+
+struct BenchStats {
+    double median;
+    double mean;
+    double stddev;
+    double min;
+};
+
+// Wall time of fn() over the given number of runs, in seconds
+template <typename Fn>
+BenchStats measure(int runs, Fn&& fn) {
+    std::vector<double> samples;
+    for (int i = 0; i < runs; ++i) {
+        BenchClock::time_point start = BenchClock::now();
+        fn();
+        samples.push_back(std::chrono::duration<double>(BenchClock::now() - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+    double mean = sum / samples.size();
+    double variance = 0.0;
+    for (double sample : samples) {
+        variance += (sample - mean) * (sample - mean);
+    }
+    variance /= samples.size() > 1 ? samples.size() - 1 : 1;
+
+    return BenchStats{samples[samples.size() / 2], mean, std::sqrt(variance), samples.front()};
+}
+
+// Keeps results alive so the compiler cannot drop the measured work
+volatile uint64_t benchSink = 0;
+
+int benchRuns = 15;
+std::string benchFilter;
+
+bool selected(const char* name) {
+    return benchFilter.empty() || std::strstr(name, benchFilter.c_str()) != nullptr;
+}
+
+// ns/op over the samples, plus a throughput in the given unit when one is set.
+// operations and items are per run.
+void report(const char* name, const BenchStats& stats, double operations, double items = 0.0, const char* unit = nullptr) {
+    std::printf("%-36s %12.1f ns/op  mean %12.1f  sd %10.1f  min %12.1f",
+                name, stats.median / operations * 1e9, stats.mean / operations * 1e9,
+                stats.stddev / operations * 1e9, stats.min / operations * 1e9);
+    if (unit) {
+        std::printf("  %10.2f %s", items / stats.median / 1e6, unit);
+    }
+    std::printf("\n");
+}
+
+// ----------------------------------------------------------------------------
+// Framebuffer writes
+
+// The framebuffer write path before the per-pixel mutexes were removed
+std::vector<std::mutex> pixelMutexes;
+
+void lockedPoint(Fragment f) {
+    size_t index = framebuffer.index(f.x, f.y);
+    std::lock_guard<std::mutex> lock(pixelMutexes[index]);
+
+    if (f.z < framebuffer.depth[index]) {
+        framebuffer.depth[index] = f.z;
+        framebuffer.color[index] = f.color.toARGB();
+    }
+}
+
+// Fixed pseudo-random fragments so every run writes the same pattern
+std::vector<Fragment> makeFragments(size_t count) {
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> xs(0, static_cast<int>(framebuffer.width) - 1);
+    std::uniform_int_distribution<int> ys(0, static_cast<int>(framebuffer.height) - 1);
+    std::uniform_real_distribution<float> zs(0.0f, 1.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<Fragment> fragments(count);
+    for (Fragment& fragment : fragments) {
+        fragment.x = static_cast<uint16_t>(xs(rng));
+        fragment.y = static_cast<uint16_t>(ys(rng));
+        fragment.z = zs(rng);
+        fragment.color = Color(255, 128, 0);
+        fragment.intensity = zs(rng);
+        // A point on the planet mesh's sphere, like the planets' model-space positions
+        glm::vec3 position(unit(rng), unit(rng), unit(rng));
+        if (glm::length(position) < 1e-3f) {
+            position = glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+        fragment.originalPos = bakeSurfaceCenter + glm::normalize(position) * bakeSurfaceRadius;
+        fragment.worldPos = fragment.originalPos;
+    }
+    return fragments;
+}
+
+void benchPoint() {
+    if (!selected("point")) {
+        return;
+    }
+    std::vector<Fragment> fragments = makeFragments(2'000'000);
+    pixelMutexes = std::vector<std::mutex>(framebuffer.width * framebuffer.height);
+
+    BenchStats locked = measure(benchRuns, [&] {
+        clearFramebuffer();
+        for (const Fragment& fragment : fragments) {
+            lockedPoint(fragment);
+        }
+    });
+    report("point/per-pixel-mutex", locked, fragments.size(), fragments.size(), "Mfragments/s");
+
+    BenchStats unlocked = measure(benchRuns, [&] {
+        clearFramebuffer();
+        for (const Fragment& fragment : fragments) {
+            point(fragment);
+        }
+    });
+    report("point/tile-owned", unlocked, fragments.size(), fragments.size(), "Mfragments/s");
+}
+
+// ----------------------------------------------------------------------------
+// Rasterizer
+
+// Screen-space vertex facing the light, so every covered pixel is emitted
+Vertex screenVertex(float x, float y) {
+    glm::vec3 position(x, y, 0.5f);
+    return Vertex{position, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f), position, position, glm::vec4(position, 1.0f)};
+}
+
+struct TriangleCase {
+    const char* name;
+    Vertex a, b, c;
+};
+
+void benchTriangle() {
+    // Counter-clockwise in screen space (y up), clear of the screen edges
+    std::vector<TriangleCase> cases = {
+        {"triangle/small", screenVertex(100.3f, 100.2f), screenVertex(104.7f, 100.6f), screenVertex(102.1f, 104.9f)},
+        {"triangle/large", screenVertex(50.5f, 50.5f), screenVertex(650.5f, 80.5f), screenVertex(300.5f, 550.5f)},
+        {"triangle/sliver", screenVertex(10.5f, 300.0f), screenVertex(790.5f, 301.5f), screenVertex(400.0f, 301.0f)},
+    };
+    int clipMaxX = static_cast<int>(framebuffer.width) - 1;
+    int clipMaxY = static_cast<int>(framebuffer.height) - 1;
+
+    for (const TriangleCase& test : cases) {
+        if (!selected(test.name)) {
+            continue;
+        }
+        // Enough repetitions for about the same amount of work in every case
+        uint64_t fragmentsPerTriangle = 0;
+        triangle(test.a, test.b, test.c, 0, 0, clipMaxX, clipMaxY, [&](Fragment&) { fragmentsPerTriangle++; });
+        size_t repetitions = std::max<size_t>(1, 4'000'000 / std::max<uint64_t>(fragmentsPerTriangle, 16));
+
+        BenchStats stats = measure(benchRuns, [&] {
+            uint64_t checksum = 0;
+            for (size_t i = 0; i < repetitions; ++i) {
+                triangle(test.a, test.b, test.c, 0, 0, clipMaxX, clipMaxY, [&](Fragment& fragment) {
+                    checksum += fragment.x;
+                });
+            }
+            benchSink = benchSink + checksum;
+        });
+        report(test.name, stats, repetitions, double(repetitions) * fragmentsPerTriangle, "Mfragments/s");
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Fragment shaders
+
+template <typename Shader>
+void benchShader(const char* name, const std::vector<Fragment>& fragments, Shader&& shader) {
+    if (!selected(name)) {
+        return;
+    }
+    std::vector<Fragment> work(fragments.size());
+    BenchStats stats = measure(benchRuns, [&] {
+        std::copy(fragments.begin(), fragments.end(), work.begin());
+        uint64_t checksum = 0;
+        for (Fragment& fragment : work) {
+            shader(fragment);
+            checksum += fragment.color.r + fragment.color.g + fragment.color.b;
+        }
+        benchSink = benchSink + checksum;
+    });
+    report(name, stats, fragments.size(), fragments.size(), "Mfragments/s");
+}
+
+void benchShaders() {
+    std::vector<Fragment> fragments = makeFragments(100'000);
+    benchShader("shader/stripes", fragments, [](Fragment& f) { fragmentShaderStripes(f); });
+    benchShader("shader/earth", fragments, [](Fragment& f) { fragmentShaderEarth(f, shaderNoise.earth); });
+    benchShader("shader/venus", fragments, [](Fragment& f) { fragmentShaderVenus(f, shaderNoise.venus); });
+    benchShader("shader/mars", fragments, [](Fragment& f) { fragmentShaderMars(f, shaderNoise.mars); });
+    benchShader("shader/saturn", fragments, [](Fragment& f) { f = fragmentShaderSaturn(f, shaderNoise.saturn); });
+    benchShader("shader/sun", fragments, [](Fragment& f) { fragmentShaderSun(f, shaderNoise.sun); });
+    benchShader("shader/default", fragments, [](Fragment& f) { fragmentShader(f, shaderNoise.animated); });
+    benchShader("shader/baked-earth", fragments, [](Fragment& f) { shadeBaked(f, ObjectType::EARTH); });
+}
+
+// ----------------------------------------------------------------------------
+// Baked surfaces
+
+// Baking one surface against mapping it back from the cache (every texel is
+// read once, as the first frames would)
+void benchBake() {
+    constexpr int WIDTH = 512;
+    constexpr int HEIGHT = WIDTH / 2;
+    constexpr double TEXELS = double(WIDTH) * HEIGHT;
+
+    BakedTexture texture;
+    if (selected("bake/earth")) {
+        BenchStats stats = measure(std::max(3, benchRuns / 3), [&] {
+            bakeSurface(ObjectType::EARTH, WIDTH, HEIGHT, threadPool, texture);
+            benchSink = benchSink + texture.texels[0];
+        });
+        report("bake/earth", stats, TEXELS, TEXELS, "Mtexels/s");
+    }
+
+    if (selected("bake/cache-load")) {
+        std::string previous = bakeCacheDirectory;
+        bakeCacheDirectory = (std::filesystem::temp_directory_path() / "bench_bake_cache").string();
+        BakeCacheKey key{static_cast<uint32_t>(ObjectType::EARTH), EARTH_SHADER_VERSION, WIDTH, HEIGHT,
+                         surfaceParamsHash(ObjectType::EARTH), bakeSurfaceCenter, bakeSurfaceRadius};
+        if (texture.empty()) {
+            bakeSurface(ObjectType::EARTH, WIDTH, HEIGHT, threadPool, texture);
+        }
+        if (writeBakeCache(key, texture)) {
+            BenchStats stats = measure(benchRuns, [&] {
+                BakedTexture loaded;
+                loadBakeCache(key, loaded);
+                uint64_t checksum = 0;
+                for (size_t i = 0; i < static_cast<size_t>(TEXELS); ++i) {
+                    checksum += loaded.texels[i];
+                }
+                benchSink = benchSink + checksum;
+            });
+            report("bake/cache-load", stats, TEXELS, TEXELS, "Mtexels/s");
+        } else {
+            std::printf("bake/cache-load: skipped, cannot write %s\n", bakeCacheDirectory.c_str());
+        }
+        std::error_code error;
+        std::filesystem::remove_all(bakeCacheDirectory, error);
+        bakeCacheDirectory = previous;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Noise
+
+void benchNoise() {
+    constexpr int SIDE = 256;
+    FastNoiseLite generator;
+
+    struct NoiseCase {
+        const char* name;
+        FastNoiseLite::NoiseType type;
+    };
+    const NoiseCase cases[] = {
+        {"noise/opensimplex2", FastNoiseLite::NoiseType_OpenSimplex2},
+        {"noise/perlin", FastNoiseLite::NoiseType_Perlin},
+        {"noise/cellular", FastNoiseLite::NoiseType_Cellular},
+    };
+
+    for (const NoiseCase& test : cases) {
+        generator.SetNoiseType(test.type);
+        std::string name2D = std::string(test.name) + "-2d";
+        std::string name3D = std::string(test.name) + "-3d";
+
+        if (selected(name2D.c_str())) {
+            BenchStats stats = measure(benchRuns, [&] {
+                float sum = 0.0f;
+                for (int y = 0; y < SIDE; ++y) {
+                    for (int x = 0; x < SIDE; ++x) {
+                        sum += generator.GetNoise(x * 1.37f, y * 1.37f);
+                    }
+                }
+                benchSink = benchSink + static_cast<uint64_t>(std::fabs(sum));
+            });
+            report(name2D.c_str(), stats, SIDE * SIDE, SIDE * SIDE, "Msamples/s");
+        }
+
+        if (selected(name3D.c_str())) {
+            constexpr int DEPTH = 4;
+            BenchStats stats = measure(benchRuns, [&] {
+                float sum = 0.0f;
+                for (int z = 0; z < DEPTH; ++z) {
+                    for (int y = 0; y < SIDE; ++y) {
+                        for (int x = 0; x < SIDE; ++x) {
+                            sum += generator.GetNoise(x * 1.37f, y * 1.37f, z * 1.37f);
+                        }
+                    }
+                }
+                benchSink = benchSink + static_cast<uint64_t>(std::fabs(sum));
+            });
+            report(name3D.c_str(), stats, SIDE * SIDE * DEPTH, SIDE * SIDE * DEPTH, "Msamples/s");
+        }
+
+        // The same samples through the batch API
+        std::string batch2D = name2D + "-batch";
+        std::string batch3D = name3D + "-batch";
+        if (selected(batch2D.c_str())) {
+            std::vector<float> samples(SIDE * SIDE);
+            BenchStats stats = measure(benchRuns, [&] {
+                getNoiseGrid(generator, 0.0f, 0.0f, 1.37f, SIDE, SIDE, samples.data());
+                benchSink = benchSink + static_cast<uint64_t>(std::fabs(samples[SIDE + 1]) * 1e6);
+            });
+            report(batch2D.c_str(), stats, SIDE * SIDE, SIDE * SIDE, "Msamples/s");
+        }
+
+        if (selected(batch3D.c_str())) {
+            constexpr int DEPTH = 4;
+            std::vector<float> samples(SIDE * SIDE * DEPTH);
+            BenchStats stats = measure(benchRuns, [&] {
+                getNoiseGrid(generator, 0.0f, 0.0f, 0.0f, 1.37f, SIDE, SIDE, DEPTH, samples.data());
+                benchSink = benchSink + static_cast<uint64_t>(std::fabs(samples[SIDE + 1]) * 1e6);
+            });
+            report(batch3D.c_str(), stats, SIDE * SIDE * DEPTH, SIDE * SIDE * DEPTH, "Msamples/s");
+        }
+    }
+}
+
+// getNoiseBatch() against GetNoise() for every setting the kernels vectorize,
+// on every instruction set this CPU has, within the tolerance noise_batch.h
+// documents. False (after printing the first mismatches) when they differ.
+bool benchNoiseVerify() {
+    const char* name = "noise/verify";
+    if (!selected(name)) {
+        return true;
+    }
+    constexpr float TOLERANCE = 1e-6f;
+    constexpr size_t COUNT = 4096;
+
+    // Random coordinates, plus integers (FastFloor's quirk below zero) and zero
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> coordinate(-1000.0f, 1000.0f);
+    std::vector<float> xs(COUNT), ys(COUNT), zs(COUNT);
+    for (size_t i = 0; i < COUNT; ++i) {
+        xs[i] = coordinate(rng);
+        ys[i] = coordinate(rng);
+        zs[i] = coordinate(rng);
+        if (i % 8 == 0) {
+            xs[i] = std::round(xs[i]);
+            ys[i] = std::round(ys[i]);
+            zs[i] = std::round(zs[i]);
+        }
+    }
+    xs[1] = ys[1] = zs[1] = 0.0f;
+
+    std::vector<SimdLevel> levels;
+    if (simdLevel == SimdLevel::AVX2) {
+        levels.push_back(SimdLevel::AVX2);
+        levels.push_back(SimdLevel::SSE41);
+    } else if (simdLevel == SimdLevel::SSE41) {
+        levels.push_back(SimdLevel::SSE41);
+    }
+
+    const FastNoiseLite::NoiseType types[] = {FastNoiseLite::NoiseType_OpenSimplex2, FastNoiseLite::NoiseType_Perlin,
+                                              FastNoiseLite::NoiseType_Cellular};
+    const FastNoiseLite::RotationType3D rotations[] = {FastNoiseLite::RotationType3D_None,
+                                                       FastNoiseLite::RotationType3D_ImproveXYPlanes,
+                                                       FastNoiseLite::RotationType3D_ImproveXZPlanes};
+    const FastNoiseLite::FractalType fractals[] = {FastNoiseLite::FractalType_None, FastNoiseLite::FractalType_FBm};
+    const FastNoiseLite::CellularDistanceFunction distances[] = {
+        FastNoiseLite::CellularDistanceFunction_Euclidean, FastNoiseLite::CellularDistanceFunction_EuclideanSq,
+        FastNoiseLite::CellularDistanceFunction_Manhattan, FastNoiseLite::CellularDistanceFunction_Hybrid};
+    const FastNoiseLite::CellularReturnType returns[] = {
+        FastNoiseLite::CellularReturnType_CellValue, FastNoiseLite::CellularReturnType_Distance,
+        FastNoiseLite::CellularReturnType_Distance2, FastNoiseLite::CellularReturnType_Distance2Add,
+        FastNoiseLite::CellularReturnType_Distance2Sub, FastNoiseLite::CellularReturnType_Distance2Mul,
+        FastNoiseLite::CellularReturnType_Distance2Div};
+
+    SimdLevel detected = simdLevel;
+    std::vector<float> expected(COUNT), batch(COUNT);
+    size_t combinations = 0;
+    size_t mismatches = 0;
+    float maxError = 0.0f;
+    auto compare = [&](int dimensions, const char* setting) {
+        combinations++;
+        for (size_t i = 0; i < COUNT; ++i) {
+            float error = std::fabs(expected[i] - batch[i]);
+            // NaN never compares, so the test is written to fail on it
+            if (!(error <= TOLERANCE)) {
+                if (mismatches < 10) {
+                    std::printf("%-36s %s %dD %s: (%g, %g, %g) scalar %.9g batch %.9g\n", name,
+                                simdLevelName(simdLevel), dimensions, setting, xs[i], ys[i],
+                                dimensions == 3 ? zs[i] : 0.0f, expected[i], batch[i]);
+                }
+                mismatches++;
+            }
+            maxError = std::max(maxError, error);
+        }
+    };
+
+    for (SimdLevel level : levels) {
+        simdLevel = level;
+        for (FastNoiseLite::NoiseType type : types) {
+            bool cellular = type == FastNoiseLite::NoiseType_Cellular;
+            for (FastNoiseLite::RotationType3D rotation : rotations) {
+                for (FastNoiseLite::FractalType fractal : fractals) {
+                    for (size_t d = 0; d < (cellular ? std::size(distances) : 1); ++d) {
+                        for (size_t r = 0; r < (cellular ? std::size(returns) : 1); ++r) {
+                            FastNoiseLite generator(1337 + static_cast<int>(combinations));
+                            generator.SetNoiseType(type);
+                            generator.SetRotationType3D(rotation);
+                            generator.SetFractalType(fractal);
+                            generator.SetFractalOctaves(3);
+                            generator.SetFrequency(0.013f);
+                            if (cellular) {
+                                generator.SetCellularDistanceFunction(distances[d]);
+                                generator.SetCellularReturnType(returns[r]);
+                                generator.SetCellularJitter(0.8f);
+                            }
+                            char setting[64];
+                            std::snprintf(setting, sizeof(setting), "type %d rotation %d fractal %d cellular %zu/%zu",
+                                          static_cast<int>(type), static_cast<int>(rotation),
+                                          static_cast<int>(fractal), d, r);
+
+                            for (size_t i = 0; i < COUNT; ++i) {
+                                expected[i] = generator.GetNoise(xs[i], ys[i]);
+                            }
+                            getNoiseBatch(generator, xs.data(), ys.data(), batch.data(), COUNT);
+                            compare(2, setting);
+
+                            for (size_t i = 0; i < COUNT; ++i) {
+                                expected[i] = generator.GetNoise(xs[i], ys[i], zs[i]);
+                            }
+                            getNoiseBatch(generator, xs.data(), ys.data(), zs.data(), batch.data(), COUNT);
+                            compare(3, setting);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    simdLevel = detected;
+
+    if (levels.empty()) {
+        std::printf("%-36s skipped, no SSE4.1 on this CPU (the batch API is the scalar loop)\n", name);
+        return true;
+    }
+    std::printf("%-36s %zu combinations x %zu samples, %zu mismatches, max error %g (tolerance %g)\n",
+                name, combinations, COUNT, mismatches, maxError, TOLERANCE);
+    return mismatches == 0;
+}
+
+// ----------------------------------------------------------------------------
+// Model loading
+
+void benchLoadOBJ(const char* name, const std::string& path) {
+    if (!selected(name)) {
+        return;
+    }
+    std::error_code error;
+    uintmax_t bytes = std::filesystem::file_size(path, error);
+    if (error) {
+        std::printf("%-36s skipped, %s not found\n", name, path.c_str());
+        return;
+    }
+
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> texCoords;
+    std::vector<Face> faces;
+    BenchStats stats = measure(std::max(3, benchRuns / 3), [&] {
+        vertices.clear();
+        normals.clear();
+        texCoords.clear();
+        faces.clear();
+        loadOBJ(path.c_str(), vertices, normals, texCoords, faces);
+    });
+    report(name, stats, 1, static_cast<double>(bytes), "MB/s");
+}
+
+// loadModel() with the binary cache already written: MB/s of the OBJ it replaces
+void benchLoadMeshCache(const char* name, const std::string& path) {
+    if (!selected(name)) {
+        return;
+    }
+    std::error_code error;
+    uintmax_t bytes = std::filesystem::file_size(path, error);
+    if (error) {
+        std::printf("%-36s skipped, %s not found\n", name, path.c_str());
+        return;
+    }
+
+    std::string previous = meshCacheDirectory;
+    meshCacheDirectory = (std::filesystem::temp_directory_path() / "bench_mesh_cache").string();
+    Mesh mesh;
+    loadModel(path.c_str(), mesh);
+    BenchStats stats = measure(benchRuns, [&] {
+        Mesh cached;
+        loadModel(path.c_str(), cached);
+        benchSink = benchSink + cached.vertexCount;
+    });
+    report(name, stats, 1, static_cast<double>(bytes), "MB/s");
+    std::filesystem::remove_all(meshCacheDirectory, error);
+    meshCacheDirectory = previous;
+}
+
+// ----------------------------------------------------------------------------
+// Present
+
+void benchPresentCopy() {
+    if (!selected("present/copy-rows")) {
+        return;
+    }
+    size_t pitch = framebuffer.width * sizeof(Uint32);
+    std::vector<Uint8> texture(pitch * framebuffer.height);
+    clearFramebuffer();
+
+    constexpr int COPIES = 50;
+    BenchStats stats = measure(benchRuns, [&] {
+        for (int i = 0; i < COPIES; ++i) {
+            copyFramebufferRows(framebuffer, texture.data(), pitch);
+        }
+        benchSink = benchSink + texture[pitch];
+    });
+    size_t pixels = framebuffer.width * framebuffer.height;
+    report("present/copy-rows", stats, COPIES, double(COPIES) * pixels, "Mpixels/s");
+}
+
+// ----------------------------------------------------------------------------
+// Vertex stage
+
+// One planet's worth of vertexShader() calls, reported per triangle corner
+// assembled so indexed and non-indexed meshes compare directly
+void benchVertex(const Mesh& mesh) {
+    if (!selected("vertex/sphere")) {
+        return;
+    }
+    Uniforms uniforms;
+    Camera camera = defaultCamera();
+    updateProjection(uniforms);
+    uniforms.model = glm::mat4(1.0f);
+    uniforms.view = glm::lookAt(camera.cameraPosition, camera.targetPosition, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    std::vector<Vertex> transformedVertices;
+    BenchStats stats = measure(benchRuns, [&] {
+        transformVertices(mesh, uniforms, transformedVertices);
+        benchSink = benchSink + transformedVertices.size();
+    });
+    double corners = static_cast<double>(mesh.triangleCount() * 3);
+    report("vertex/sphere", stats, 1, corners, "Mcorners/s");
+}
+
+// transformVerticesAVX2() against vertexShader() on the same mesh, for a few
+// model and view matrices. Every component of position, normal, worldPos and
+// clipPos has to agree within TOLERANCE, relative to the scalar value (or
+// absolute, below 1). False (after printing the first mismatches) when they
+// differ.
+bool benchVertexVerify(const Mesh& mesh) {
+    const char* name = "vertex/verify";
+    if (!selected(name)) {
+        return true;
+    }
+#if SIMD_X86
+    if (simdLevel != SimdLevel::AVX2) {
+        std::printf("%-36s skipped, no AVX2 on this CPU (the vertex stage is scalar)\n", name);
+        return true;
+    }
+    constexpr float TOLERANCE = 2e-6f;
+
+    Uniforms uniforms;
+    updateProjection(uniforms);
+    const glm::mat4 models[] = {
+        glm::mat4(1.0f),
+        // Non-uniform scale, so the normal matrix is not the model matrix
+        glm::scale(glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.3f, -0.2f, 0.1f)), 0.7f,
+                               glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f))),
+                   glm::vec3(0.15f, 0.3f, 0.2f)),
+    };
+    const glm::vec3 eyes[] = {defaultCamera().cameraPosition, glm::vec3(0.8f, 0.6f, 1.2f)};
+
+    std::vector<Vertex> expected(mesh.vertexCount), batch(mesh.vertexCount);
+    size_t compared = 0;
+    size_t mismatches = 0;
+    float maxError = 0.0f;
+    auto compare = [&](const char* member, size_t vertex, const float* a, const float* b, int components) {
+        for (int c = 0; c < components; ++c) {
+            float error = std::fabs(a[c] - b[c]) / std::max(1.0f, std::fabs(a[c]));
+            // NaN never compares, so the test is written to fail on it
+            if (!(error <= TOLERANCE)) {
+                if (mismatches < 10) {
+                    std::printf("%-36s vertex %zu %s[%d]: scalar %.9g avx2 %.9g\n", name, vertex, member, c, a[c], b[c]);
+                }
+                mismatches++;
+            }
+            maxError = std::max(maxError, error);
+        }
+    };
+
+    for (const glm::mat4& model : models) {
+        for (const glm::vec3& eye : eyes) {
+            uniforms.model = model;
+            uniforms.view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            VertexTransform transform = vertexTransform(uniforms);
+            for (size_t i = 0; i < mesh.vertexCount; ++i) {
+                expected[i] = vertexShader(vertexInput(mesh.positions, mesh.normals, mesh.texCoords, i), transform);
+            }
+            // The whole mesh, then a range that starts and ends off a group of eight
+            size_t ranges[2][2] = {{0, mesh.vertexCount}, {std::min<size_t>(3, mesh.vertexCount), mesh.vertexCount - mesh.vertexCount / 3}};
+            for (const size_t* range : ranges) {
+                transformVerticesAVX2(mesh.positions, mesh.normals, mesh.texCoords, range[0], range[1], transform,
+                                      batch.data());
+                for (size_t i = range[0]; i < range[1]; ++i) {
+                    compare("position", i, &expected[i].position.x, &batch[i].position.x, 3);
+                    compare("normal", i, &expected[i].normal.x, &batch[i].normal.x, 3);
+                    compare("worldPos", i, &expected[i].worldPos.x, &batch[i].worldPos.x, 3);
+                    compare("clipPos", i, &expected[i].clipPos.x, &batch[i].clipPos.x, 4);
+                }
+                compared += range[1] - range[0];
+            }
+        }
+    }
+
+    std::printf("%-36s %zu vertices, %zu mismatches, max error %g (tolerance %g)\n",
+                name, compared, mismatches, maxError, TOLERANCE);
+    return mismatches == 0;
+#else
+    std::printf("%-36s skipped, not an x86 build (the vertex stage is scalar)\n", name);
+    return true;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// Whole frames
+
+// Like report(), in ms per frame and frames/s; frames is per run
+void reportFrames(const char* name, const BenchStats& stats, int frames) {
+    std::printf("%-36s %12.3f ms/frame  mean %12.3f  sd %10.3f  min %12.3f  %10.1f frames/s\n",
+                name, stats.median / frames * 1e3, stats.mean / frames * 1e3,
+                stats.stddev / frames * 1e3, stats.min / frames * 1e3, frames / stats.median);
+}
+
+void benchFrames(const Mesh& mesh, bool deferred) {
+    const char* name = deferred ? "frame/deferred" : "frame/forward";
+    if (!selected(name)) {
+        return;
+    }
+
+    // Same starting state for every run: planets, stars and animation counter
+    constexpr int FRAMES = 30;
+    bool previous = deferredShading;
+    deferredShading = deferred;
+    Uniforms uniforms;
+    Camera camera = defaultCamera();
+    updateProjection(uniforms);
+
+    BenchStats stats = measure(std::max(3, benchRuns / 3), [&] {
+        setupPlanets();
+        srand(1);
+        frame = 0;
+        for (int i = 0; i < FRAMES; ++i) {
+            renderFrame(mesh, uniforms, camera);
+        }
+    });
+    deferredShading = previous;
+
+    reportFrames(name, stats, FRAMES);
+}
+
+// The camera flies straight through the sun, so triangles cross the near plane
+// and the camera ends up inside and behind planets
+void benchFlyby(const Mesh& mesh) {
+    const char* name = "frame/flyby";
+    if (!selected(name)) {
+        return;
+    }
+
+    constexpr int FRAMES = 30;
+    Uniforms uniforms;
+    updateProjection(uniforms);
+
+    BenchStats stats = measure(std::max(3, benchRuns / 3), [&] {
+        setupPlanets();
+        srand(1);
+        frame = 0;
+        for (int i = 0; i < FRAMES; ++i) {
+            Camera camera = defaultCamera();
+            float z = 0.5f - static_cast<float>(i) / (FRAMES - 1);
+            camera.cameraPosition = glm::vec3(-0.1f, 0.0f, z);
+            camera.targetPosition = glm::vec3(-0.1f, 0.0f, z - 1.0f);
+            renderFrame(mesh, uniforms, camera);
+        }
+    });
+
+    reportFrames(name, stats, FRAMES);
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc) {
+            benchRuns = std::max(1, std::atoi(argv[++i]));
+        } else {
+            benchFilter = arg;
+        }
+    }
+
+    std::printf("%zux%zu, %zu threads, %s kernels, %d runs per benchmark\n",
+                framebuffer.width, framebuffer.height, threadPool.size(), simdLevelName(simdLevel), benchRuns);
+    setupNoise();
+    updateNoise(frame);
+    // The surfaces are baked at the radius of the mesh the frames are drawn with
+    Mesh sphere;
+    bool sphereLoaded = loadModel("../models/sphere.obj", sphere);
+    if (sphereLoaded) {
+        bakeSurfaceCenter = sphere.boundsCenter;
+        bakeSurfaceRadius = sphere.boundsRadius;
+    }
+    bakePlanetSurfaces(threadPool);
+
+    benchPoint();
+    benchTriangle();
+    benchShaders();
+    benchBake();
+    benchNoise();
+    bool noiseVerified = benchNoiseVerify();
+    benchLoadOBJ("loadOBJ/sphere", "../models/sphere.obj");
+    benchLoadOBJ("loadOBJ/diablo3", "../models/diablo3.obj");
+    benchLoadOBJ("loadOBJ/earth", "../models/earth.obj");
+    benchLoadOBJ("loadOBJ/model", "../models/model.obj");
+    benchLoadMeshCache("loadModel/cached-sphere", "../models/sphere.obj");
+    benchLoadMeshCache("loadModel/cached-diablo3", "../models/diablo3.obj");
+    benchPresentCopy();
+
+    bool vertexVerified = true;
+    if (selected("vertex/sphere") || selected("vertex/verify") || selected("frame/forward") ||
+        selected("frame/deferred") || selected("frame/flyby")) {
+        if (!sphereLoaded) {
+            std::printf("vertex/*, frame/*: skipped, ../models/sphere.obj not found\n");
+            return noiseVerified ? 0 : 1;
+        }
+        benchVertex(sphere);
+        vertexVerified = benchVertexVerify(sphere);
+        benchFrames(sphere, false);
+        benchFrames(sphere, true);
+        benchFlyby(sphere);
+    }
+
+    return noiseVerified && vertexVerified ? 0 : 1;
+}
@@ -46,6 +46,11 @@ struct Color {
         );
     }
 
+    // Packed the way SDL_PIXELFORMAT_ARGB8888 stores a pixel in a Uint32
+    Uint32 toARGB() const {
+        return (Uint32(a) << 24) | (Uint32(r) << 16) | (Uint32(g) << 8) | Uint32(b);
+    }
+
     // Friend function to allow float * Color
     friend Color operator*(float factor, const Color& color);
 
@@ -9,22 +9,19 @@ struct Vertex {
   glm::vec3 tex;
   glm::vec3 worldPos;
   glm::vec3 originalPos;
+  glm::vec4 clipPos;  // before the perspective divide, for clipping
 };
 
 struct Fragment {
   uint16_t x;      
   uint16_t y;      
-  double z;  // zbuffer
+  float z;  // zbuffer
   Color color; // r, g, b values for color
   float intensity;  // light intensity
   glm::vec3 worldPos;
   glm::vec3 originalPos;
 };
 
-struct FragColor {
-  Color color;
-  double z; // instead of z buffer
-};
 
 
 
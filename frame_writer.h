@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "framebuffer.h"
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+// Output of the headless mode. PPM frames are plain binary P6 images; RGBA
+// frames are headerless top-down rows of 8-bit R, G, B, A, which encoders read
+// as raw video given the size (for ffmpeg: -f rawvideo -pix_fmt rgba -s WxH).
+enum class FrameFormat {
+    PPM,
+    RGBA
+};
+
+// Writes every frame to "<directory>/frame_00000.ppm" and so on, or
+// back to back to stdout when the destination is "-".
+class FrameWriter {
+public:
+    FrameWriter() = default;
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    ~FrameWriter() {
+        if (toStdout) {
+            std::fflush(stdout);
+        }
+    }
+
+    bool open(const std::string& destination, FrameFormat frameFormat) {
+        format = frameFormat;
+        frameIndex = 0;
+        toStdout = destination == "-";
+        if (toStdout) {
+#if defined(_WIN32)
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            return true;
+        }
+
+        directory = destination;
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        return std::filesystem::is_directory(directory);
+    }
+
+    bool write(const Framebuffer& source) {
+        FILE* file = stdout;
+        if (!toStdout) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "frame_%05zu.%s", frameIndex, format == FrameFormat::PPM ? "ppm" : "rgba");
+            file = std::fopen((directory / name).string().c_str(), "wb");
+            if (!file) {
+                return false;
+            }
+        }
+
+        bool written = writeImage(file, source);
+        if (!toStdout) {
+            written = std::fclose(file) == 0 && written;
+        }
+        frameIndex++;
+        return written;
+    }
+
+private:
+    bool writeImage(FILE* file, const Framebuffer& source) {
+        size_t channels = format == FrameFormat::PPM ? 3 : 4;
+        if (format == FrameFormat::PPM) {
+            std::fprintf(file, "P6\n%zu %zu\n255\n", source.width, source.height);
+        }
+
+        // The framebuffer is bottom-up; images are written top row first
+        row.resize(source.width * channels);
+        for (size_t y = 0; y < source.height; y++) {
+            const Uint32* pixels = &source.color[(source.height - y - 1) * source.width];
+            uint8_t* out = row.data();
+            for (size_t x = 0; x < source.width; x++) {
+                Uint32 argb = pixels[x];
+                *out++ = static_cast<uint8_t>(argb >> 16);
+                *out++ = static_cast<uint8_t>(argb >> 8);
+                *out++ = static_cast<uint8_t>(argb);
+                if (channels == 4) {
+                    *out++ = static_cast<uint8_t>(argb >> 24);
+                }
+            }
+            if (std::fwrite(row.data(), 1, row.size(), file) != row.size()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    FrameFormat format = FrameFormat::PPM;
+    bool toStdout = false;
+    std::filesystem::path directory;
+    size_t frameIndex = 0;
+    std::vector<uint8_t> row;
+};
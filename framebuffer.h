@@ -1,62 +1,126 @@
 #pragma once
-#include <array>
 #include <algorithm>
+#include <cmath>
 #include "glm/glm.hpp"
 #include <limits>
-#include <mutex>
+#include <new>
 #include "color.h"  // Include your Color class header
 #include "fragment.h"
 
-constexpr size_t SCREEN_WIDTH = 800;
-constexpr size_t SCREEN_HEIGHT = 600;
+// Size used when nothing else is requested on the command line
+constexpr size_t DEFAULT_SCREEN_WIDTH = 800;
+constexpr size_t DEFAULT_SCREEN_HEIGHT = 600;
 
-FragColor blank{
-  Color{0, 0, 0},
-  std::numeric_limits<double>::max()
-};
+// Heap array aligned to a cache line (and to any SIMD register width)
+template <typename T>
+class AlignedArray {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    AlignedArray() = default;
+    AlignedArray(const AlignedArray&) = delete;
+    AlignedArray& operator=(const AlignedArray&) = delete;
 
-std::array<FragColor, SCREEN_WIDTH * SCREEN_HEIGHT> framebuffer;
+    ~AlignedArray() {
+        release();
+    }
 
-// Create a 2D array of mutexes
-std::array<std::mutex, SCREEN_WIDTH * SCREEN_HEIGHT> mutexes;
+    // Contents are left uninitialized
+    void resize(size_t count) {
+        if (count == length) {
+            return;
+        }
+        release();
+        if (count > 0) {
+            elements = static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(ALIGNMENT)));
+            length = count;
+        }
+    }
 
-void point(Fragment f) {
-    std::lock_guard<std::mutex> lock(mutexes[f.y * SCREEN_WIDTH + f.x]);
+    size_t size() const { return length; }
+    T* data() { return elements; }
+    const T* data() const { return elements; }
+    T* begin() { return elements; }
+    T* end() { return elements + length; }
+    T& operator[](size_t i) { return elements[i]; }
+    const T& operator[](size_t i) const { return elements[i]; }
 
-    if (f.z < framebuffer[f.y * SCREEN_WIDTH + f.x].z) {
-       framebuffer[f.y * SCREEN_WIDTH + f.x] = FragColor{f.color, f.z};
+private:
+    void release() {
+        if (elements) {
+            ::operator delete(elements, std::align_val_t(ALIGNMENT));
+        }
+        elements = nullptr;
+        length = 0;
     }
-}
 
-void clearFramebuffer() {
-    std::fill(framebuffer.begin(), framebuffer.end(), blank);
-}
+    T* elements = nullptr;
+    size_t length = 0;
+};
+
+// The framebuffer is split into two planes: 32-bit depth and 32-bit packed
+// ARGB color. Depth-only work (early-Z, hierarchical Z, the visibility pass)
+// only touches the depth plane, and the color plane already has the layout of
+// the SDL texture. Its size is chosen at startup and can change at runtime.
+struct Framebuffer {
+    size_t width = 0;
+    size_t height = 0;
+    AlignedArray<float> depth;
+    AlignedArray<Uint32> color;
 
-void renderBuffer(SDL_Renderer* renderer) {
-    SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
+    Framebuffer(size_t width, size_t height) {
+        resize(width, height);
+    }
+
+    // Contents are undefined until the next clearFramebuffer()
+    void resize(size_t newWidth, size_t newHeight) {
+        width = newWidth;
+        height = newHeight;
+        depth.resize(width * height);
+        color.resize(width * height);
+    }
 
-    void* texturePixels;
-    int pitch;
-    SDL_LockTexture(texture, NULL, &texturePixels, &pitch);
-    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    size_t index(int x, int y) const {
+        return static_cast<size_t>(y) * width + x;
+    }
+};
 
-    Uint32 format = SDL_PIXELFORMAT_ARGB8888;
-    SDL_PixelFormat* mappingFormat = SDL_AllocFormat(format);
+constexpr float CLEAR_DEPTH = std::numeric_limits<float>::max();
+// The 2D layers sit behind every planet, just in front of the cleared depth,
+// so the planets always cover them: the stars, and the orbits over the stars.
+// A fixed depth keeps the frames the same from one run to the next.
+const float STAR_DEPTH = std::nextafter(CLEAR_DEPTH, 0.0f);
+const float ORBIT_DEPTH = std::nextafter(STAR_DEPTH, 0.0f);
 
-    Uint32* texturePixels32 = static_cast<Uint32*>(texturePixels);
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            int framebufferY = SCREEN_HEIGHT - y - 1;  // Reverse the order of rows
-            int index = y * (pitch / sizeof(Uint32)) + x;
-            const Color& color = framebuffer[framebufferY * SCREEN_WIDTH + x].color;
-            texturePixels32[index] = SDL_MapRGBA(mappingFormat, color.r, color.g, color.b, color.a);
-        }
+// True while no planet has been drawn on the pixel: the depth is still the
+// cleared one or one of the 2D layers'
+bool isBackgroundDepth(float depth) {
+    return depth >= ORBIT_DEPTH;
+}
+const Uint32 CLEAR_COLOR = Color(0, 0, 0).toARGB();
+
+Framebuffer framebuffer(DEFAULT_SCREEN_WIDTH, DEFAULT_SCREEN_HEIGHT);
+
+// No locking: render() gives every screen tile to a single worker thread, and
+// everything else (stars, orbits, clearing, presenting) runs on the main thread
+// while no tile work is in flight. Each pixel therefore has one writer at a time.
+// Returns true when the fragment passed the depth test and was stored.
+bool point(Fragment f) {
+    size_t index = framebuffer.index(f.x, f.y);
+    if (f.z < framebuffer.depth[index]) {
+        framebuffer.depth[index] = f.z;
+        framebuffer.color[index] = f.color.toARGB();
+        return true;
     }
+    return false;
+}
 
-    SDL_UnlockTexture(texture);
-    SDL_Rect textureRect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
-    SDL_RenderCopy(renderer, texture, NULL, &textureRect);
-    SDL_DestroyTexture(texture);
+// Same comparison as point(), for rejecting fragments before they are shaded
+bool passesDepthTest(const Fragment& f) {
+    return f.z < framebuffer.depth[framebuffer.index(f.x, f.y)];
+}
 
-    SDL_RenderPresent(renderer);
+void clearFramebuffer() {
+    std::fill(framebuffer.depth.begin(), framebuffer.depth.end(), CLEAR_DEPTH);
+    std::fill(framebuffer.color.begin(), framebuffer.color.end(), CLEAR_COLOR);
 }
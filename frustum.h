@@ -0,0 +1,57 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include "glm/glm.hpp"
+
+// The six planes of the camera's view volume in world space, taken straight
+// from projection * view (Gribb and Hartmann), with inward unit normals:
+// dot(normal, p) + distance is how far p is inside each plane.
+struct Frustum {
+    glm::vec3 normal[6];
+    float distance[6];
+};
+
+Frustum extractFrustum(const glm::mat4& viewProjection) {
+    // glm is column-major: row r of the matrix is (m[0][r], m[1][r], m[2][r], m[3][r])
+    auto row = [&](int r) {
+        return glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+    };
+    glm::vec4 planes[6] = {
+        row(3) + row(0),  // left
+        row(3) - row(0),  // right
+        row(3) + row(1),  // bottom
+        row(3) - row(1),  // top
+        row(3) + row(2),  // near
+        row(3) - row(2)   // far
+    };
+
+    Frustum frustum;
+    for (int i = 0; i < 6; ++i) {
+        glm::vec3 normal(planes[i]);
+        float length = std::sqrt(glm::dot(normal, normal));
+        frustum.normal[i] = normal / length;
+        frustum.distance[i] = planes[i].w / length;
+    }
+    return frustum;
+}
+
+// False only when the sphere is entirely outside one of the planes. Spheres
+// near a corner of the frustum can pass without touching it, which only costs
+// a draw that the clipper then throws away.
+bool sphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius) {
+    for (int i = 0; i < 6; ++i) {
+        if (glm::dot(frustum.normal[i], center) + frustum.distance[i] < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The mesh's model-space bounding sphere through the model matrix. The radius
+// grows by the largest axis scale, so it stays conservative under non-uniform scale.
+bool meshInFrustum(const Frustum& frustum, const glm::mat4& model, const glm::vec3& boundsCenter, float boundsRadius) {
+    glm::vec3 center(model * glm::vec4(boundsCenter, 1.0f));
+    float scale = std::max(std::max(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1]))),
+                           glm::length(glm::vec3(model[2])));
+    return sphereInFrustum(frustum, center, boundsRadius * scale);
+}
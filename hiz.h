@@ -0,0 +1,134 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "framebuffer.h"
+#include "tiles.h"
+
+// Hierarchical Z: the nearest and farthest depth stored in every 8x8 block of
+// a tile, plus the same bounds for the whole tile. Lets render() drop a
+// triangle before it is rasterized when every pixel it could touch already
+// holds something nearer, and skip the per-pixel early depth test when every
+// pixel is farther away.
+constexpr int HIZ_BLOCK_SIZE = 8;
+constexpr int HIZ_BLOCKS_PER_SIDE = TILE_SIZE / HIZ_BLOCK_SIZE;
+
+static_assert(TILE_SIZE % HIZ_BLOCK_SIZE == 0, "tiles must be made of whole blocks");
+static_assert(HIZ_BLOCKS_PER_SIDE * HIZ_BLOCKS_PER_SIDE <= 64, "block masks are 64 bits wide");
+
+struct DepthBounds {
+    float min;
+    float max;
+};
+
+struct TileDepth {
+    DepthBounds bounds;
+    std::array<DepthBounds, HIZ_BLOCKS_PER_SIDE * HIZ_BLOCKS_PER_SIDE> blocks;
+};
+
+std::vector<TileDepth> tileDepths;
+
+enum class DepthTestResult {
+    OCCLUDED,  // no fragment can pass the depth test
+    VISIBLE,   // every fragment passes the depth test
+    PARTIAL
+};
+
+void clearTileDepths() {
+    tileDepths.resize(tileCount());
+    DepthBounds cleared{CLEAR_DEPTH, CLEAR_DEPTH};
+    for (TileDepth& depth : tileDepths) {
+        depth.bounds = cleared;
+        depth.blocks.fill(cleared);
+    }
+}
+
+// Bit of the 8x8 block holding pixel (x, y) of the tile
+uint64_t hizBlockBit(const Tile& tile, int x, int y) {
+    int blockX = (x - tile.minX) / HIZ_BLOCK_SIZE;
+    int blockY = (y - tile.minY) / HIZ_BLOCK_SIZE;
+    return uint64_t(1) << (blockY * HIZ_BLOCKS_PER_SIDE + blockX);
+}
+
+// Rebuilds the bounds of the blocks in dirtyBlocks from the depth buffer, then
+// the bounds of the whole tile
+void updateTileDepth(size_t tileIndex, const Tile& tile, uint64_t dirtyBlocks) {
+    TileDepth& depth = tileDepths[tileIndex];
+
+    while (dirtyBlocks) {
+        int block = std::countr_zero(dirtyBlocks);
+        dirtyBlocks &= dirtyBlocks - 1;
+
+        int startX = tile.minX + (block % HIZ_BLOCKS_PER_SIDE) * HIZ_BLOCK_SIZE;
+        int startY = tile.minY + (block / HIZ_BLOCKS_PER_SIDE) * HIZ_BLOCK_SIZE;
+        int endX = std::min(startX + HIZ_BLOCK_SIZE - 1, tile.maxX);
+        int endY = std::min(startY + HIZ_BLOCK_SIZE - 1, tile.maxY);
+
+        DepthBounds bounds{CLEAR_DEPTH, -CLEAR_DEPTH};
+        for (int y = startY; y <= endY; ++y) {
+            for (int x = startX; x <= endX; ++x) {
+                float z = framebuffer.depth[framebuffer.index(x, y)];
+                bounds.min = std::min(bounds.min, z);
+                bounds.max = std::max(bounds.max, z);
+            }
+        }
+        depth.blocks[block] = bounds;
+    }
+
+    DepthBounds tileBounds{CLEAR_DEPTH, -CLEAR_DEPTH};
+    int blocksX = (tile.maxX - tile.minX) / HIZ_BLOCK_SIZE + 1;
+    int blocksY = (tile.maxY - tile.minY) / HIZ_BLOCK_SIZE + 1;
+    for (int blockY = 0; blockY < blocksY; ++blockY) {
+        for (int blockX = 0; blockX < blocksX; ++blockX) {
+            const DepthBounds& bounds = depth.blocks[blockY * HIZ_BLOCKS_PER_SIDE + blockX];
+            tileBounds.min = std::min(tileBounds.min, bounds.min);
+            tileBounds.max = std::max(tileBounds.max, bounds.max);
+        }
+    }
+    depth.bounds = tileBounds;
+}
+
+// Classifies a triangle against the depth already in the tile, using the
+// triangle's depth range and the blocks its bounding box overlaps. The bounds
+// may be stale in the conservative direction only (writes outside render()
+// can make pixels nearer), so OCCLUDED is always safe to drop.
+DepthTestResult testTileDepth(size_t tileIndex, const Tile& tile, const glm::vec3& A, const glm::vec3& B, const glm::vec3& C) {
+    const TileDepth& depth = tileDepths[tileIndex];
+    float minZ = std::min(std::min(A.z, B.z), C.z);
+    float maxZ = std::max(std::max(A.z, B.z), C.z);
+
+    if (minZ >= depth.bounds.max)
+        return DepthTestResult::OCCLUDED;
+    if (maxZ < depth.bounds.min)
+        return DepthTestResult::VISIBLE;
+
+    float minX = std::max(std::ceil(std::min(std::min(A.x, B.x), C.x)), static_cast<float>(tile.minX));
+    float minY = std::max(std::ceil(std::min(std::min(A.y, B.y), C.y)), static_cast<float>(tile.minY));
+    float maxX = std::min(std::floor(std::max(std::max(A.x, B.x), C.x)), static_cast<float>(tile.maxX));
+    float maxY = std::min(std::floor(std::max(std::max(A.y, B.y), C.y)), static_cast<float>(tile.maxY));
+    if (!(minX <= maxX && minY <= maxY))
+        return DepthTestResult::OCCLUDED;
+
+    int firstBlockX = (static_cast<int>(minX) - tile.minX) / HIZ_BLOCK_SIZE;
+    int firstBlockY = (static_cast<int>(minY) - tile.minY) / HIZ_BLOCK_SIZE;
+    int lastBlockX = (static_cast<int>(maxX) - tile.minX) / HIZ_BLOCK_SIZE;
+    int lastBlockY = (static_cast<int>(maxY) - tile.minY) / HIZ_BLOCK_SIZE;
+
+    bool occluded = true;
+    bool visible = true;
+    for (int blockY = firstBlockY; blockY <= lastBlockY; ++blockY) {
+        for (int blockX = firstBlockX; blockX <= lastBlockX; ++blockX) {
+            const DepthBounds& bounds = depth.blocks[blockY * HIZ_BLOCKS_PER_SIDE + blockX];
+            occluded = occluded && minZ >= bounds.max;
+            visible = visible && maxZ < bounds.min;
+        }
+    }
+
+    if (occluded)
+        return DepthTestResult::OCCLUDED;
+    return visible ? DepthTestResult::VISIBLE : DepthTestResult::PARTIAL;
+}
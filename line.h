@@ -1,14 +1,13 @@
 #pragma once
-#include <vector>
 #include "glm/glm.hpp"
 #include "fragment.h"
 
-std::vector<Fragment> line(const glm::vec3& v1, const glm::vec3& v2) {
+// Bresenham line; every pixel is passed to onFragment(Fragment&) as it is visited
+template <typename FragmentCallback>
+void line(const glm::vec3& v1, const glm::vec3& v2, FragmentCallback&& onFragment) {
     glm::ivec2 p1(static_cast<int>(v1.x), static_cast<int>(v1.y));
     glm::ivec2 p2(static_cast<int>(v2.x), static_cast<int>(v2.y));
 
-    std::vector<Fragment> fragments;
-
     int dx = std::abs(p2.x - p1.x);
     int dy = std::abs(p2.y - p1.y);
     int sx = (p1.x < p2.x) ? 1 : -1;
@@ -19,11 +18,11 @@ std::vector<Fragment> line(const glm::vec3& v1, const glm::vec3& v2) {
     glm::ivec2 current = p1;
 
     while (true) {
-        Fragment fragment;
+        Fragment fragment{};
         fragment.x = current.x;
         fragment.y = current.y;
 
-        fragments.push_back(fragment);
+        onFragment(fragment);
 
         if (current == p2) {
             break;
@@ -39,6 +38,4 @@ std::vector<Fragment> line(const glm::vec3& v1, const glm::vec3& v2) {
             current.y += sy;
         }
     }
-
-    return fragments;
 }
@@ -3,23 +3,137 @@
 #include <iostream>
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include <cstdio>
+#include <cstdlib>
 #include <sstream>
+#include <string>
 #include <vector>
+#include <chrono>
 #include "color.h"
 #include "framebuffer.h"
 #include "uniforms.h"
-#include "shaders.h"
 #include "fragment.h"
-#include "triangle.h"
 #include "camera.h"
-#include "ObjLoader.h"
-#include "noise.h"
+#include "scene.h"
+#include "presenter.h"
+#include "frame_writer.h"
 #include <unordered_map>
 
 
 SDL_Window* window = nullptr;
 SDL_Renderer* renderer = nullptr;
 Color currentColor;
+Presenter presenter;
+
+struct Options {
+    size_t width = DEFAULT_SCREEN_WIDTH;
+    size_t height = DEFAULT_SCREEN_HEIGHT;
+    bool headless = false;
+    int frames = 300;
+    std::string output;  // vacio: no se escriben frames, "-": stdout
+    FrameFormat format = FrameFormat::PPM;
+    unsigned int seed = 1;  // la misma semilla que rand() usa sin srand()
+    bool deferred = false;
+    bool profile = false;
+    std::string profileOutput;  // .csv o .json, se escribe al salir
+    std::string traceOutput = "trace.json";
+    bool trace = false;
+    bool procedural = false;
+    int bakeWidth = 1024;
+    std::string bakeCache = "bake_cache";  // vacio: no se usa el cache
+    std::string meshCache = "mesh_cache";  // vacio: el OBJ se lee siempre
+    CullMode cull = CullMode::BACK;
+};
+
+// Opciones:
+//   --size WxH | --width W --height H   resolucion inicial
+//   --headless                          sin ventana, dibuja --frames frames y termina
+//   --frames N                          cantidad de frames en modo headless
+//   --output DIR | --output -           carpeta (o stdout) donde escribir los frames
+//   --format ppm | rgba                 formato de los frames escritos
+//   --seed N                            semilla de las estrellas
+//   --deferred                          empezar con el visibility buffer activo
+//   --profile                           medir cada etapa del frame (tecla P en la ventana)
+//   --profile-out FILE.csv|FILE.json    guardar las mediciones de todos los frames al salir
+//   --trace FILE.json                   grabar un trace de Chrome/Perfetto y guardarlo al salir
+//   --procedural                        evaluar el ruido de los planetas en cada pixel, sin texturas horneadas
+//   --bake-size N                       ancho de las texturas horneadas (el alto es N/2)
+//   --bake-cache DIR | --no-bake-cache  carpeta donde se guardan las texturas horneadas entre corridas
+//   --mesh-cache DIR | --no-mesh-cache  carpeta donde se guardan los modelos ya convertidos a binario
+//   --cull back | front | none          que triangulos se descartan segun hacia donde miran
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--width" && hasValue) {
+            options.width = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--height" && hasValue) {
+            options.height = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--size" && hasValue) {
+            unsigned long w = 0, h = 0;
+            if (std::sscanf(argv[++i], "%lux%lu", &w, &h) != 2) {
+                return false;
+            }
+            options.width = w;
+            options.height = h;
+        } else if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = std::atoi(argv[++i]);
+        } else if (arg == "--output" && hasValue) {
+            options.output = argv[++i];
+        } else if (arg == "--format" && hasValue) {
+            std::string format = argv[++i];
+            if (format == "ppm") {
+                options.format = FrameFormat::PPM;
+            } else if (format == "rgba") {
+                options.format = FrameFormat::RGBA;
+            } else {
+                return false;
+            }
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--deferred") {
+            options.deferred = true;
+        } else if (arg == "--profile") {
+            options.profile = true;
+        } else if (arg == "--profile-out" && hasValue) {
+            options.profile = true;
+            options.profileOutput = argv[++i];
+        } else if (arg == "--trace" && hasValue) {
+            options.trace = true;
+            options.traceOutput = argv[++i];
+        } else if (arg == "--procedural") {
+            options.procedural = true;
+        } else if (arg == "--bake-size" && hasValue) {
+            options.bakeWidth = std::atoi(argv[++i]);
+        } else if (arg == "--bake-cache" && hasValue) {
+            options.bakeCache = argv[++i];
+        } else if (arg == "--no-bake-cache") {
+            options.bakeCache.clear();
+        } else if (arg == "--mesh-cache" && hasValue) {
+            options.meshCache = argv[++i];
+        } else if (arg == "--no-mesh-cache") {
+            options.meshCache.clear();
+        } else if (arg == "--cull" && hasValue) {
+            std::string cull = argv[++i];
+            if (cull == "back") {
+                options.cull = CullMode::BACK;
+            } else if (cull == "front") {
+                options.cull = CullMode::FRONT;
+            } else if (cull == "none") {
+                options.cull = CullMode::NONE;
+            } else {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    // Fragment guarda x e y en 16 bits
+    return options.width > 0 && options.height > 0 && options.width <= 65535 && options.height <= 65535 &&
+           options.frames >= 0 && options.bakeWidth >= 2;
+}
 
 bool init() {
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
@@ -27,7 +141,7 @@ bool init() {
         return false;
     }
 
-    window = SDL_CreateWindow("Software Renderer", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+    window = SDL_CreateWindow("Software Renderer", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, static_cast<int>(framebuffer.width), static_cast<int>(framebuffer.height), SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
     if (!window) {
         std::cerr << "Error: Fallo en la creacion SDL window: " << SDL_GetError() << std::endl;
         return false;
@@ -39,7 +153,10 @@ bool init() {
         return false;
     }
 
-    setupNoise();
+    if (!presenter.create(renderer)) {
+        std::cerr << "Error: Fallo en la creacion SDL texture: " << SDL_GetError() << std::endl;
+        return false;
+    }
 
     return true;
 }
@@ -48,179 +165,45 @@ void setColor(const Color& color) {
     currentColor = color;
 }
 
-void render(const std::vector<glm::vec3>& VBO, const Uniforms& uniforms) {
-    std::vector<Vertex> transformedVertices(VBO.size() / 3);
-    for (size_t i = 0; i < VBO.size() / 3; ++i) {
-        Vertex vertex = { VBO[i * 3], VBO[i * 3 + 1], VBO[i * 3 + 2] };
-        transformedVertices[i] = vertexShader(vertex, uniforms);
-    }
-    std::vector<std::vector<Vertex>> assembledVertices(transformedVertices.size() / 3);
-    for (size_t i = 0; i < transformedVertices.size() / 3; ++i) {
-        Vertex edge1 = transformedVertices[3 * i];
-        Vertex edge2 = transformedVertices[3 * i + 1];
-        Vertex edge3 = transformedVertices[3 * i + 2];
-        assembledVertices[i] = { edge1, edge2, edge3 };
-    }
-    std::vector<Fragment> fragments;
-    for (size_t i = 0; i < assembledVertices.size(); ++i) {
-        std::vector<Fragment> rasterizedTriangle = triangle(
-                assembledVertices[i][0],
-                assembledVertices[i][1],
-                assembledVertices[i][2]
-        );
-        fragments.insert(fragments.end(), rasterizedTriangle.begin(), rasterizedTriangle.end());
+// Dibuja los frames sin abrir ninguna ventana; el tiempo medido no incluye la carga del modelo
+int runHeadless(const Options& options, const Mesh& mesh, Uniforms& uniforms, const Camera& camera) {
+    FrameWriter writer;
+    bool writeFrames = !options.output.empty();
+    if (writeFrames && !writer.open(options.output, options.format)) {
+        std::cerr << "Error: no se pudo abrir la salida " << options.output << std::endl;
+        return 1;
     }
-    for (size_t i = 0; i < fragments.size(); ++i) {
-        Fragment& fragment = fragments[i];
 
-        if (uniforms.objectType == ObjectType::SOL) {
-            fragmentShaderSun(fragment);
-        } else if (uniforms.objectType == ObjectType::MARS) {
-            fragmentShaderMars(fragment);
-        } else if (uniforms.objectType == ObjectType::EARTH) {
-            fragmentShaderEarth(fragment);
-        } else if (uniforms.objectType == ObjectType::VENUS) {
-            fragmentShaderVenus(fragment);
-        } else if (uniforms.objectType == ObjectType::SATURN) {
-            fragmentShaderSaturn(fragment);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.frames; ++i) {
+        if (profilingEnabled) {
+            profiler.beginFrame();
         }
-        point(fragment);
-    }
-}
-
-glm::mat4 createViewportMatrix(size_t screenWidth, size_t screenHeight) {
-    glm::mat4 viewport = glm::mat4(1.0f);
-    viewport = glm::scale(viewport, glm::vec3(screenWidth / 2.0f, screenHeight / 2.0f, 0.5f));
-    viewport = glm::translate(viewport, glm::vec3(1.0f, 1.0f, 0.5f));
-
-    return viewport;
-}
-
-struct Planet {
-    ObjectType type;
-    float Radius;
-    float escala_F;
-    float Velocidad__;
-    float Angulo_P;
-};
-
-
-struct PlanetOrbit {
-    glm::vec2 lastPoint;
-    std::vector<glm::vec2> points;
-};
-
-
-void drawOrbit(const Planet& planet, const Uniforms& uniforms) {
-    const int numSegments = 100;
-
-    // Color de órbita
-    Fragment frag;
-    frag.color = Color(1.0f, 1.0f, 1.0f);
-
-    glm::vec4 planetPosition = uniforms.projection * uniforms.view * glm::vec4(glm::vec3(uniforms.model[3]), 1.0f);
-    glm::vec2 screenPos = glm::vec2((planetPosition.x / planetPosition.w + 1.0f) * 0.5f * SCREEN_WIDTH,
-                                    (1.0f - planetPosition.y / planetPosition.w) * 0.5f * SCREEN_HEIGHT);
-
-    static std::vector<glm::vec2> points;
-    
-    if (points.size() == 0) {
-        points.push_back(screenPos);
-    }
-
-    for (int i = 0; i <= numSegments; ++i) {
-        float theta = planet.Angulo_P - static_cast<float>(i) / numSegments * glm::two_pi<float>();
-        float x = screenPos.x + planet.Radius * cos(theta);
-        float y = screenPos.y - planet.Radius * sin(theta);
-
-        if (points.size() > 0) {
-            points.push_back(glm::vec2(x, y));
+        renderFrame(mesh, uniforms, camera);
+        if (writeFrames) {
+            ProfileScope scope(ProfileStage::PRESENT);
+            TRACE_SCOPE("present");
+            if (!writer.write(framebuffer)) {
+                std::cerr << "Error: no se pudo escribir el frame " << i << std::endl;
+                return 1;
+            }
         }
-    }
-
-    // Dibujar líneas entre puntos, excluyendo el primer punto
-    for (int i = 0; i < points.size() - 1; i++) {
-        glm::vec3 p1(points[i].x, points[i].y, 0);
-        glm::vec3 p2(points[i + 1].x, points[i + 1].y, 0);
-
-        std::vector<Fragment> fragments = line(p1, p2);
-
-        // Dibujar fragments
-        for (Fragment f : fragments) {
-            // Asignar color blanco
-            f.color = frag.color;
-            point(f);
+        if (profilingEnabled) {
+            profiler.endFrame();
         }
     }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-    if (points.size() > 1000) {
-        points.erase(points.begin(), points.begin() + points.size() - 1000);
-    }
+    // stderr, para no mezclarse con los frames cuando se escriben a stdout
+    std::cerr << options.frames << " frames " << framebuffer.width << "x" << framebuffer.height
+              << " en " << seconds << " s (" << (seconds > 0 ? options.frames / seconds : 0.0) << " FPS)" << std::endl;
+    return 0;
 }
 
-
-
-std::vector<Planet> planets;
-int currentPlanet = 0;
-
-int main(int argc, char* argv[]) {
-    if (!init()) {
-        return 1;
-    }
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec3> texCoords;
-    std::vector<Face> faces;
-    std::vector<glm::vec3> vertexBufferObject;
-
-    loadOBJ("../models/sphere.obj", vertices, normals, texCoords, faces);
-
-    for (const auto& face : faces)
-    {
-        for (int i = 0; i < 3; ++i)
-        {
-            glm::vec3 vertexPosition = vertices[face.vertexIndices[i]];
-            glm::vec3 vertexNormal = normals[face.normalIndices[i]];
-            glm::vec3 vertexTexture = texCoords[face.texIndices[i]];
-            vertexBufferObject.push_back(vertexPosition);
-            vertexBufferObject.push_back(vertexNormal);
-            vertexBufferObject.push_back(vertexTexture);
-        }
-    }
-
-    Uniforms uniforms;
-
-    glm::mat4 view = glm::mat4(1);
-    glm::mat4 projection = glm::mat4(1);
-    glm::vec3 translationVector(0.0f, 0.0f, 0.0f);
-    float a = 45.0f;
-    glm::vec3 rotationAxis(0.0f, 1.0f, 0.0f);
-    glm::vec3 escala_F(1.0f, 1.0f, 1.0f);
-
-    Camera camera;
-    camera.cameraPosition = glm::vec3(0.0f, 0.0f, 1.5f);
-    camera.targetPosition = glm::vec3(0.0f, 0.0f, 0.0f);
-    camera.upVector = glm::vec3(0.0f, 1.0f, 0.0f);
-    float fovInDegrees = 45.0f;
-    float aspectRatio = static_cast<float>(SCREEN_WIDTH) / static_cast<float>(SCREEN_HEIGHT);
-    float nearClip = 0.1f;
-    float farClip = 100.0f;
-    uniforms.projection = glm::perspective(glm::radians(fovInDegrees), aspectRatio, nearClip, farClip);
-
-    uniforms.viewport = createViewportMatrix(SCREEN_WIDTH, SCREEN_HEIGHT);
+void runWindow(const Options& options, const Mesh& mesh, Uniforms& uniforms, Camera& camera) {
     Uint32 frameStart, frameTime;
-    std::string title = "FPS: ";
-    int speed = 10;
-    planets.push_back({ ObjectType::SOL, 0.1f, 0.15f, 0.0f, 0.0f });
-    planets.push_back({ ObjectType::EARTH, 0.25f, 0.06f,0.07f, 0.0f });
-    planets.push_back({ ObjectType::SATURN, 0.35f, 0.06f,0.05f, 0.0f });
-    planets.push_back({ ObjectType::MARS, 0.45f, 0.08f,0.03f, 0.0f });
-    planets.push_back({ ObjectType::VENUS, 0.56f, 0.08f,0.01f, 0.0f });
-
     bool running = true;
-    float fixedDeltaTime = 0.2f;
     while (running) {
-        frame += 1;
         frameStart = SDL_GetTicks();
 
         SDL_Event event;
@@ -229,11 +212,39 @@ int main(int argc, char* argv[]) {
                 running = false;
             }
 
+            // El framebuffer sigue el tamaño de la ventana
+            if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED &&
+                event.window.data1 > 0 && event.window.data2 > 0) {
+                framebuffer.resize(event.window.data1, event.window.data2);
+                updateProjection(uniforms);
+            }
+
             if (event.type == SDL_KEYDOWN) {
                 switch (event.key.keysym.sym) {
                     case SDLK_SPACE:
                         currentPlanet = (currentPlanet + 1) % planets.size();
                         break;
+                    case SDLK_v:
+                        // Alternar entre shading directo y visibility buffer
+                        deferredShading = !deferredShading;
+                        break;
+                    case SDLK_p:
+                        // Mostrar u ocultar el profiler
+                        profilingEnabled = !profilingEnabled;
+                        break;
+                    case SDLK_t:
+                        // Empieza a grabar un trace nuevo, o lo guarda y deja de grabar
+                        // (asi al salir no se vuelve a escribir encima)
+                        if (!traceEnabled) {
+                            tracer.clear();
+                            traceEnabled = true;
+                        } else {
+                            traceEnabled = false;
+                            if (tracer.write(options.traceOutput)) {
+                                std::cout << "Trace guardado en " << options.traceOutput << std::endl;
+                            }
+                        }
+                        break;
                     case SDLK_LEFT:
                         camera.cameraPosition.x -= 0.1f;
                         break;
@@ -256,64 +267,104 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        uniforms.view = glm::lookAt(
-                camera.cameraPosition,
-                camera.targetPosition,
-                glm::vec3(0.0f, 1.0f, 0.0f)
-        );
+        bool profiling = profilingEnabled;
+        if (profiling) {
+            profiler.beginFrame();
+        }
 
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        clearFramebuffer();
-        int numStars = rand() % 500;
-        for(int i = 0; i < numStars; i++) {
-
-            int x = rand() % SCREEN_WIDTH;
-            int y = rand() % SCREEN_HEIGHT;
+        renderFrame(mesh, uniforms, camera);
 
-            Fragment star;
-            star.x = x;
-            star.y = y;
-            star.color = Color(1.0f, 1.0f, 1.0f);
-
-            point(star);
+        // Las barras muestran el frame anterior, el actual aun no termina
+        const FrameProfile* lastProfile = profiler.lastFrame();
+        if (profiling && lastProfile) {
+            drawProfileOverlay(*lastProfile);
         }
-
-
-        for (auto& planet : planets) {
-            uniforms.objectType = planet.type;
-            glm::vec3 systemOffset(-0.1f, 0.0f, 0.0f);
-            float Angulo_P = planet.Angulo_P;
-            float Radius = planet.Radius;
-            float orbitX = Radius * cos(Angulo_P);
-            float orbitY = Radius * sin(Angulo_P);
-            glm::mat4 translate = glm::translate(glm::mat4(1.0f), systemOffset);
-            glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(planet.Angulo_P), glm::vec3(0.0f, 1.0f, 0.0f));
-            glm::mat4 translation = glm::translate(glm::mat4(1.0f), glm::vec3(orbitX, 0.0f, orbitY));
-            glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(planet.escala_F));
-            glm::mat4 model = translate * rotation * translation * scale;
-
-            uniforms.model = model;
-
-            drawOrbit(planet, uniforms);
-
-            render(vertexBufferObject, uniforms);
-            planet.Angulo_P += planet.Velocidad__ * fixedDeltaTime;
+        {
+            ProfileScope scope(ProfileStage::PRESENT);
+            TRACE_SCOPE("present");
+            presenter.present(framebuffer);
         }
 
-        renderBuffer(renderer);
-
-        frameTime = SDL_GetTicks() - frameStart;
-        if (frameTime > 0) {
-            std::ostringstream titleStream;
-            titleStream << "FPS: " << 1000.0 / frameTime;
-            SDL_SetWindowTitle(window, titleStream.str().c_str());
+        if (profiling) {
+            profiler.endFrame();
+            SDL_SetWindowTitle(window, profileSummary(*profiler.lastFrame()).c_str());
+        } else {
+            frameTime = SDL_GetTicks() - frameStart;
+            if (frameTime > 0) {
+                std::ostringstream titleStream;
+                titleStream << "FPS: " << 1000.0 / frameTime;
+                SDL_SetWindowTitle(window, titleStream.str().c_str());
+            }
         }
         SDL_Delay(16);
     }
 
+    presenter.destroy();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
+}
 
-    return 0;
-}
\ No newline at end of file
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Error: opciones invalidas" << std::endl;
+        return 1;
+    }
+    framebuffer.resize(options.width, options.height);
+    deferredShading = options.deferred;
+    cullMode = options.cull;
+    profilingEnabled = options.profile;
+    // Todos los frames solo si se van a guardar; si no, los ultimos en un anillo
+    if (options.profileOutput.empty()) {
+        profiler.setHistoryCapacity(PROFILE_RING_FRAMES);
+    }
+    traceEnabled = options.trace;
+    // El hilo principal es el primero en registrarse en el trace
+    tracer.threadRing();
+    srand(options.seed);
+
+    if (!options.headless && !init()) {
+        return 1;
+    }
+    meshCacheDirectory = options.meshCache;
+    Mesh mesh;
+    if (!loadModel("../models/sphere.obj", mesh)) {
+        std::cerr << "Error: no se pudo cargar ../models/sphere.obj" << std::endl;
+        return 1;
+    }
+
+    setupNoise();
+    bakedShading = !options.procedural;
+    bakeWidth = options.bakeWidth;
+    bakeCacheDirectory = options.bakeCache;
+    // Los shaders leen la posicion del modelo tal cual: se hornea sobre su esfera envolvente
+    bakeSurfaceCenter = mesh.boundsCenter;
+    bakeSurfaceRadius = mesh.boundsRadius;
+    if (bakedShading) {
+        bakePlanetSurfaces(threadPool);
+    }
+
+    Uniforms uniforms;
+    Camera camera = defaultCamera();
+    updateProjection(uniforms);
+    setupPlanets();
+
+    int result = 0;
+    if (options.headless) {
+        result = runHeadless(options, mesh, uniforms, camera);
+    } else {
+        runWindow(options, mesh, uniforms, camera);
+    }
+
+    if (!options.profileOutput.empty() && !writeProfile(options.profileOutput)) {
+        std::cerr << "Error: no se pudo escribir " << options.profileOutput << std::endl;
+        return 1;
+    }
+    if (traceEnabled && !tracer.write(options.traceOutput)) {
+        std::cerr << "Error: no se pudo escribir " << options.traceOutput << std::endl;
+        return 1;
+    }
+    return result;
+}
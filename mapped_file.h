@@ -0,0 +1,166 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file (mmap on POSIX, MapViewOfFile on Windows).
+// The pages are loaded by the OS on first touch, so opening a large cache
+// file costs almost nothing and its data can be used in place, without a copy.
+// The view starts at a page boundary, so any offset aligned in the file is
+// aligned in memory too.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept {
+        *this = static_cast<MappedFile&&>(other);
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            bytes = other.bytes;
+            length = other.length;
+            other.bytes = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    // False if the file does not exist, is empty or cannot be mapped
+    bool open(const std::string& path) {
+        close();
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+        if (!mapping) {
+            return false;
+        }
+        // The view keeps the mapping alive after its handle is closed
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (!view) {
+            return false;
+        }
+        bytes = static_cast<const uint8_t*>(view);
+        length = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(file, &info) != 0 || info.st_size <= 0) {
+            ::close(file);
+            return false;
+        }
+        void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        // The mapping stays valid after the descriptor is closed
+        ::close(file);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+        bytes = static_cast<const uint8_t*>(view);
+        length = static_cast<size_t>(info.st_size);
+#endif
+        return true;
+    }
+
+    void close() {
+        if (bytes) {
+#if defined(_WIN32)
+            UnmapViewOfFile(bytes);
+#else
+            munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+        }
+        bytes = nullptr;
+        length = 0;
+    }
+
+    bool isOpen() const {
+        return bytes != nullptr;
+    }
+
+    const uint8_t* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+};
+
+// Numbers the temporary files of writeFileAtomically() within this process
+inline std::atomic<unsigned> atomicWriteCount{0};
+
+// Writes path all at once or not at all, for the cache files MappedFile maps
+// back. write(FILE*) fills a temporary file next to it, named after this
+// process (and call), so two runs sharing a cache directory never write into
+// the same file; only a complete file is renamed over path, and a failed one
+// is removed. The directory is created if needed.
+template <typename WriteContents>
+bool writeFileAtomically(const std::filesystem::path& path, WriteContents&& write) {
+#if defined(_WIN32)
+    unsigned long processId = GetCurrentProcessId();
+#else
+    unsigned long processId = static_cast<unsigned long>(getpid());
+#endif
+    std::filesystem::path temporary = path;
+    temporary += "." + std::to_string(processId) + "." + std::to_string(atomicWriteCount++) + ".tmp";
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    FILE* file = std::fopen(temporary.string().c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = write(file);
+    written = std::fclose(file) == 0 && written;
+    if (written) {
+        std::filesystem::rename(temporary, path, error);
+        written = !error;
+    }
+    if (!written) {
+        std::filesystem::remove(temporary, error);
+    }
+    return written;
+}
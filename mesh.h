@@ -0,0 +1,454 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "glm/glm.hpp"
+#include "mapped_file.h"
+#include "ObjLoader.h"
+
+// Mesh ready for the vertex stage: one position, normal and texture
+// coordinate per unique vertex, and three indices into them per triangle.
+// Corners that share position, normal and texture coordinate share a vertex,
+// so the vertex shader runs once per vertex instead of once per corner.
+//
+// Parsing an OBJ is slow, so the first load also writes the arrays to a cache
+// file (mesh_cache/ by default) and later loads map that file and point the
+// arrays straight into it: loading a cached mesh costs the same whatever its size.
+
+struct Mesh {
+    size_t vertexCount = 0;
+    const glm::vec3* positions = nullptr;
+    const glm::vec3* normals = nullptr;
+    const glm::vec3* texCoords = nullptr;  // null when loaded without them
+    // 0: not indexed, every three consecutive vertices form a triangle
+    size_t indexCount = 0;
+    const uint32_t* indices = nullptr;
+    // Sphere around every position, in model space
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+
+    // The arrays point either into this storage (just parsed) or into the mapping
+    std::vector<glm::vec3> positionStorage;
+    std::vector<glm::vec3> normalStorage;
+    std::vector<glm::vec3> texCoordStorage;
+    std::vector<uint32_t> indexStorage;
+    MappedFile mapping;
+
+    size_t triangleCount() const {
+        return (indexCount ? indexCount : vertexCount) / 3;
+    }
+
+    // Vertex index of corner k (0..2) of the triangle
+    uint32_t corner(size_t triangle, int k) const {
+        size_t i = 3 * triangle + k;
+        return indices ? indices[i] : static_cast<uint32_t>(i);
+    }
+};
+
+std::string meshCacheDirectory = "mesh_cache";  // empty: always parse, never write
+
+// Nothing in the renderer samples a texture (the planets are shaded from their
+// model-space position), so texture coordinates are dropped by default. They
+// would otherwise split shared vertices: sphere.obj gives every corner of every
+// face its own one, and keeping them leaves 1890 vertices instead of 482.
+bool meshTexCoords = false;
+
+// Centered on the bounding box of the positions: not the smallest sphere, but
+// close to it for the round meshes drawn here, and found in one pass
+void computeMeshBounds(Mesh& mesh) {
+    if (mesh.vertexCount == 0) {
+        mesh.boundsCenter = glm::vec3(0.0f);
+        mesh.boundsRadius = 0.0f;
+        return;
+    }
+    glm::vec3 lower = mesh.positions[0];
+    glm::vec3 upper = mesh.positions[0];
+    for (size_t i = 1; i < mesh.vertexCount; ++i) {
+        lower = glm::min(lower, mesh.positions[i]);
+        upper = glm::max(upper, mesh.positions[i]);
+    }
+    mesh.boundsCenter = (lower + upper) * 0.5f;
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < mesh.vertexCount; ++i) {
+        glm::vec3 offset = mesh.positions[i] - mesh.boundsCenter;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    mesh.boundsRadius = std::sqrt(radiusSquared);
+}
+
+// Points the arrays at the storage vectors
+void useMeshStorage(Mesh& mesh) {
+    mesh.vertexCount = mesh.positionStorage.size();
+    mesh.positions = mesh.positionStorage.data();
+    mesh.normals = mesh.normalStorage.data();
+    mesh.texCoords = mesh.texCoordStorage.empty() ? nullptr : mesh.texCoordStorage.data();
+    mesh.indexCount = mesh.indexStorage.size();
+    mesh.indices = mesh.indexStorage.empty() ? nullptr : mesh.indexStorage.data();
+    mesh.mapping.close();
+    computeMeshBounds(mesh);
+}
+
+// ----------------------------------------------------------------------------
+// Vertex cache order
+//
+// Tipsify (Sander, Nehab and Barczak 2007): triangles are emitted as fans
+// around a vertex that is still in a FIFO cache of cacheSize entries, so
+// neighbouring triangles reuse the vertices the previous ones just used.
+// Linear in the number of triangles; returns the reordered index list.
+
+std::vector<uint32_t> tipsify(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+
+    // Triangles around each vertex, as offsets into one list
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (uint32_t index : indices) {
+        adjacencyOffset[index + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        adjacencyOffset[v + 1] += adjacencyOffset[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    // Triangles not emitted yet around each vertex
+    std::vector<int> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        live[v] = static_cast<int>(adjacencyOffset[v + 1] - adjacencyOffset[v]);
+    }
+    std::vector<int> cacheTime(vertexCount, 0);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    int timestamp = cacheSize + 1;
+    size_t cursor = 1;
+    long long fanning = vertexCount ? 0 : -1;
+    while (fanning >= 0) {
+        candidates.clear();
+        for (uint32_t a = adjacencyOffset[fanning]; a < adjacencyOffset[fanning + 1]; ++a) {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = 1;
+            for (int k = 0; k < 3; ++k) {
+                uint32_t v = indices[3 * triangle + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (timestamp - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = timestamp++;
+                }
+            }
+        }
+
+        // Next fan: the candidate that stays longest in the cache and still has triangles
+        fanning = -1;
+        int bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] <= 0) {
+                continue;
+            }
+            int priority = 0;
+            if (timestamp - cacheTime[v] + 2 * live[v] <= cacheSize) {
+                priority = timestamp - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+        // Dead end: a recently used vertex, or else the next one in input order
+        while (fanning < 0 && !deadEnd.empty()) {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) {
+                fanning = v;
+            }
+        }
+        while (fanning < 0 && cursor < vertexCount) {
+            if (live[cursor] > 0) {
+                fanning = static_cast<long long>(cursor);
+            }
+            ++cursor;
+        }
+    }
+    return output;
+}
+
+// Un vertice por cada combinacion distinta de posicion, normal y coordenada de
+// textura, y tres indices por cara en el orden de Tipsify
+bool loadOBJMesh(const char* path, Mesh& mesh) {
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> texCoords;
+    std::vector<Face> faces;
+
+    if (!loadOBJ(path, vertices, normals, texCoords, faces)) {
+        return false;
+    }
+
+    // Corners with the same position, normal and texture coordinate values are
+    // the same vertex, even when the OBJ lists those values more than once
+    // (sphere.obj repeats its four texture coordinates over and over).
+    // Missing normals and dropped texture coordinates are the zero vector.
+    struct CornerKey {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec3 tex;
+        bool operator==(const CornerKey& other) const {
+            return std::memcmp(this, &other, sizeof(CornerKey)) == 0;
+        }
+    };
+    static_assert(sizeof(CornerKey) == 9 * sizeof(float), "compared and hashed bitwise");
+    struct CornerHash {
+        size_t operator()(const CornerKey& key) const {
+            uint32_t words[9];
+            std::memcpy(words, &key, sizeof(words));
+            uint64_t hash = 14695981039346656037ull;  // FNV-1a over the words
+            for (uint32_t word : words) {
+                hash = (hash ^ word) * 1099511628211ull;
+            }
+            return static_cast<size_t>(hash ^ (hash >> 32));
+        }
+    };
+    std::unordered_map<CornerKey, uint32_t, CornerHash> unique;
+    unique.reserve(faces.size() * 3);
+
+    std::vector<uint32_t> indices;
+    std::vector<CornerKey> corners;
+    indices.reserve(faces.size() * 3);
+    for (const auto& face : faces) {
+        for (int i = 0; i < 3; ++i) {
+            int normal = face.normalIndices[i];
+            int tex = face.texIndices[i];
+            CornerKey key = {
+                vertices[face.vertexIndices[i]],
+                normal >= 0 ? normals[normal] : glm::vec3(0.0f),
+                meshTexCoords && tex >= 0 ? texCoords[tex] : glm::vec3(0.0f)
+            };
+            auto [entry, inserted] = unique.try_emplace(key, static_cast<uint32_t>(corners.size()));
+            if (inserted) {
+                corners.push_back(key);
+            }
+            indices.push_back(entry->second);
+        }
+    }
+    indices = tipsify(indices, corners.size(), 16);
+
+    // Vertices in the order the reordered triangles first use them
+    std::vector<uint32_t> remap(corners.size(), UINT32_MAX);
+    std::vector<uint32_t> order;
+    order.reserve(corners.size());
+    for (uint32_t& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(order.size());
+            order.push_back(index);
+        }
+        index = remap[index];
+    }
+
+    mesh.positionStorage.clear();
+    mesh.normalStorage.clear();
+    mesh.texCoordStorage.clear();
+    mesh.positionStorage.reserve(order.size());
+    mesh.normalStorage.reserve(order.size());
+    mesh.texCoordStorage.reserve(meshTexCoords ? order.size() : 0);
+    for (uint32_t corner : order) {
+        mesh.positionStorage.push_back(corners[corner].position);
+        mesh.normalStorage.push_back(corners[corner].normal);
+        if (meshTexCoords) {
+            mesh.texCoordStorage.push_back(corners[corner].tex);
+        }
+    }
+    mesh.indexStorage = std::move(indices);
+    useMeshStorage(mesh);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Cache files
+//
+// A 128-byte header followed by the position, normal, texture coordinate and
+// index arrays, each starting at a multiple of 64 bytes, in native byte order.
+// The header records the size and modification time of the OBJ it was built
+// from; a cache file that does not match the OBJ on disk is built again.
+
+constexpr char MESH_CACHE_MAGIC[4] = {'S', 'P', 'M', 'S'};
+constexpr uint32_t MESH_CACHE_VERSION = 4;  // bump when the layout or the vertex data change
+constexpr uint64_t MESH_CACHE_HEADER_SIZE = 128;
+constexpr uint64_t MESH_CACHE_ALIGNMENT = 64;
+
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t vertexCount;
+    uint64_t texCoordCount;  // vertexCount, or 0 when loaded without texture coordinates
+    uint64_t indexCount;
+    uint64_t positionOffset;
+    uint64_t normalOffset;
+    uint64_t texCoordOffset;
+    uint64_t indexOffset;
+    float boundsCenter[3];
+    float boundsRadius;
+};
+static_assert(sizeof(MeshCacheHeader) <= MESH_CACHE_HEADER_SIZE, "the arrays start after the header");
+
+struct MeshSource {
+    uint64_t size;
+    int64_t time;
+};
+
+bool meshSource(const char* path, MeshSource& source) {
+    std::error_code error;
+    source.size = std::filesystem::file_size(path, error);
+    if (error) {
+        return false;
+    }
+    source.time = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+    return !error;
+}
+
+// mesh_cache/<name>.<hash of the path>.mesh, so models with the same name in
+// different folders get their own file
+std::filesystem::path meshCachePath(const char* path) {
+    uint32_t hash = 2166136261u;  // FNV-1a
+    for (const char* c = path; *c; ++c) {
+        hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+    }
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%08x.mesh", hash);
+    std::string name = std::filesystem::path(path).filename().string() + suffix;
+    return std::filesystem::path(meshCacheDirectory) / name;
+}
+
+uint64_t alignMeshOffset(uint64_t offset) {
+    return (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+}
+
+// Offsets of the arrays for the given counts; returns the file size
+uint64_t meshCacheLayout(MeshCacheHeader& header) {
+    uint64_t vec3Bytes = header.vertexCount * sizeof(glm::vec3);
+    header.positionOffset = MESH_CACHE_HEADER_SIZE;
+    header.normalOffset = alignMeshOffset(header.positionOffset + vec3Bytes);
+    header.texCoordOffset = alignMeshOffset(header.normalOffset + vec3Bytes);
+    header.indexOffset = alignMeshOffset(header.texCoordOffset + header.texCoordCount * sizeof(glm::vec3));
+    return header.indexOffset + header.indexCount * sizeof(uint32_t);
+}
+
+// Maps the cache file of the model and points the arrays into it. False when
+// there is no cache file or it is truncated, of another version or stale.
+bool loadMeshCache(const char* path, const MeshSource& source, Mesh& mesh) {
+    MappedFile file;
+    if (!file.open(meshCachePath(path).string()) || file.size() < MESH_CACHE_HEADER_SIZE) {
+        return false;
+    }
+
+    MeshCacheHeader stored;
+    std::memcpy(&stored, file.data(), sizeof(stored));
+    if (std::memcmp(stored.magic, MESH_CACHE_MAGIC, sizeof(stored.magic)) != 0 ||
+        stored.version != MESH_CACHE_VERSION || stored.sourceSize != source.size || stored.sourceTime != source.time ||
+        stored.vertexCount > file.size() || stored.indexCount > file.size() ||
+        stored.texCoordCount != (meshTexCoords ? stored.vertexCount : 0)) {
+        return false;
+    }
+    MeshCacheHeader expected = stored;
+    if (meshCacheLayout(expected) > file.size() || expected.positionOffset != stored.positionOffset ||
+        expected.normalOffset != stored.normalOffset || expected.texCoordOffset != stored.texCoordOffset ||
+        expected.indexOffset != stored.indexOffset) {
+        return false;
+    }
+
+    mesh.positionStorage.clear();
+    mesh.normalStorage.clear();
+    mesh.texCoordStorage.clear();
+    mesh.indexStorage.clear();
+    mesh.vertexCount = static_cast<size_t>(stored.vertexCount);
+    mesh.positions = reinterpret_cast<const glm::vec3*>(file.data() + stored.positionOffset);
+    mesh.normals = reinterpret_cast<const glm::vec3*>(file.data() + stored.normalOffset);
+    mesh.texCoords = stored.texCoordCount ? reinterpret_cast<const glm::vec3*>(file.data() + stored.texCoordOffset) : nullptr;
+    mesh.indexCount = static_cast<size_t>(stored.indexCount);
+    mesh.indices = stored.indexCount ? reinterpret_cast<const uint32_t*>(file.data() + stored.indexOffset) : nullptr;
+    // Stored, so that loading still does not touch the vertex pages
+    mesh.boundsCenter = glm::vec3(stored.boundsCenter[0], stored.boundsCenter[1], stored.boundsCenter[2]);
+    mesh.boundsRadius = stored.boundsRadius;
+    mesh.mapping = std::move(file);
+    return true;
+}
+
+// Through writeFileAtomically(), like the baked surfaces: a reader never maps
+// a half-written mesh, even with several runs sharing the cache directory
+bool writeMeshCache(const char* path, const MeshSource& source, const Mesh& mesh) {
+    MeshCacheHeader header{};
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.sourceSize = source.size;
+    header.sourceTime = source.time;
+    header.vertexCount = mesh.vertexCount;
+    header.texCoordCount = mesh.texCoords ? mesh.vertexCount : 0;
+    header.indexCount = mesh.indexCount;
+    header.boundsCenter[0] = mesh.boundsCenter.x;
+    header.boundsCenter[1] = mesh.boundsCenter.y;
+    header.boundsCenter[2] = mesh.boundsCenter.z;
+    header.boundsRadius = mesh.boundsRadius;
+    meshCacheLayout(header);
+
+    return writeFileAtomically(meshCachePath(path), [&](FILE* file) {
+        uint64_t position = 0;
+        bool written = true;
+        // Zero padding up to offset, then the bytes
+        auto put = [&](uint64_t offset, const void* bytes, uint64_t size) {
+            static const unsigned char zeros[MESH_CACHE_HEADER_SIZE] = {};
+            while (written && position < offset) {
+                uint64_t padding = std::min<uint64_t>(offset - position, sizeof(zeros));
+                written = std::fwrite(zeros, 1, padding, file) == padding;
+                position += padding;
+            }
+            if (written && size) {
+                written = std::fwrite(bytes, 1, size, file) == size;
+                position += size;
+            }
+        };
+        uint64_t vec3Bytes = mesh.vertexCount * sizeof(glm::vec3);
+        put(0, &header, sizeof(header));
+        put(header.positionOffset, mesh.positions, vec3Bytes);
+        put(header.normalOffset, mesh.normals, vec3Bytes);
+        put(header.texCoordOffset, mesh.texCoords, header.texCoordCount * sizeof(glm::vec3));
+        put(header.indexOffset, mesh.indices, mesh.indexCount * sizeof(uint32_t));
+        return written;
+    });
+}
+
+// Carga el modelo desde el cache si esta al dia; si no, lee el OBJ y guarda el cache
+bool loadModel(const char* path, Mesh& mesh) {
+    MeshSource source;
+    if (!meshSource(path, source)) {
+        return false;
+    }
+    bool cached = !meshCacheDirectory.empty();
+    if (cached && loadMeshCache(path, source, mesh)) {
+        return true;
+    }
+    if (!loadOBJMesh(path, mesh)) {
+        return false;
+    }
+    if (cached) {
+        writeMeshCache(path, source, mesh);
+    }
+    return true;
+}
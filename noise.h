@@ -1,12 +1,35 @@
 #pragma once
 #include "./FastNoise.h"
+#include <cstdlib>
 #include <vector>
 
 constexpr int NOISE_WIDTH = 512;
 constexpr int NOISE_HEIGHT = 512;
 
-FastNoiseLite noise;
+// Noise generators of every material. setupNoise() configures them once and
+// after that the shaders only call GetNoise(), which is const, so every
+// shading thread reads the same objects without copying or locking them.
+struct ShaderNoise {
+  FastNoiseLite earth;     // OpenSimplex2
+  FastNoiseLite venus;     // Perlin
+  FastNoiseLite mars;      // Perlin
+  FastNoiseLite saturn;    // Perlin, both cloud layers
+  FastNoiseLite sun;       // Perlin
+  FastNoiseLite animated;  // Cellular, for fragmentShader(); its frequency follows the frame
+};
+
+ShaderNoise shaderNoise;
 
 void setupNoise() {
-  noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2); // Set the noise type to Perlin
+  shaderNoise.earth.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+  shaderNoise.venus.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+  shaderNoise.mars.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+  shaderNoise.saturn.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+  shaderNoise.sun.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+  shaderNoise.animated.SetNoiseType(FastNoiseLite::NoiseType_Cellular);
+}
+
+// Per-frame parameters; call before any fragment of the frame is shaded
+void updateNoise(int frame) {
+  shaderNoise.animated.SetFrequency(0.02 + (10 - abs((static_cast<int>(frame/10.0f) % (2 * 10)) - 10))/2000.0f);
 }
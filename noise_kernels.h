@@ -0,0 +1,537 @@
+// Batch noise kernels for noise_batch.h, written once against the vector
+// operations defined there. It is included once per instruction set, inside
+// that set's namespace and with NOISE_TARGET set to its target attribute, so
+// there is no include guard. Every function mirrors the FastNoiseLite function
+// of the same name, operation for operation.
+
+NOISE_TARGET inline VI fastFloor(VF f) {
+    // (int)f, minus one below zero (also for negative integers, like FastFloor)
+    return add(truncate(f), asInt(cmpLt(f, splat(0.0f))));
+}
+
+NOISE_TARGET inline VI fastRound(VF f) {
+    VF nonNegative = cmpGe(f, splat(0.0f));
+    return truncate(select(nonNegative, add(f, splat(0.5f)), sub(f, splat(0.5f))));
+}
+
+NOISE_TARGET inline VF fastAbs(VF f) {
+    return select(cmpLt(f, splat(0.0f)), vneg(f), f);
+}
+
+NOISE_TARGET inline VF lerp(VF a, VF b, VF t) {
+    return add(a, mul(t, sub(b, a)));
+}
+
+NOISE_TARGET inline VF interpQuintic(VF t) {
+    VF inner = add(mul(t, sub(mul(t, splat(6.0f)), splat(15.0f))), splat(10.0f));
+    return mul(mul(mul(t, t), t), inner);
+}
+
+NOISE_TARGET inline VI hash(VI seed, VI xPrimed, VI yPrimed) {
+    return mul(bxor(bxor(seed, xPrimed), yPrimed), splat(0x27d4eb2d));
+}
+
+NOISE_TARGET inline VI hash(VI seed, VI xPrimed, VI yPrimed, VI zPrimed) {
+    return mul(bxor(bxor(bxor(seed, xPrimed), yPrimed), zPrimed), splat(0x27d4eb2d));
+}
+
+NOISE_TARGET inline VF gradCoord(VI seed, VI xPrimed, VI yPrimed, VF xd, VF yd) {
+    VI h = hash(seed, xPrimed, yPrimed);
+    h = band(bxor(h, shiftRight15(h)), splat(127 << 1));
+    const float* gradients = FastNoiseBatch::gradients2D();
+    VF xg = gather(gradients, h);
+    VF yg = gather(gradients, bor(h, splat(1)));
+    return add(mul(xd, xg), mul(yd, yg));
+}
+
+NOISE_TARGET inline VF gradCoord(VI seed, VI xPrimed, VI yPrimed, VI zPrimed, VF xd, VF yd, VF zd) {
+    VI h = hash(seed, xPrimed, yPrimed, zPrimed);
+    h = band(bxor(h, shiftRight15(h)), splat(63 << 2));
+    const float* gradients = FastNoiseBatch::gradients3D();
+    VF xg = gather(gradients, h);
+    VF yg = gather(gradients, bor(h, splat(1)));
+    VF zg = gather(gradients, bor(h, splat(2)));
+    return add(add(mul(xd, xg), mul(yd, yg)), mul(zd, zg));
+}
+
+// (a * a) * (a * a) * gradient where a > 0, zero elsewhere
+NOISE_TARGET inline VF falloff(VF a, VF gradient) {
+    VF a2 = mul(a, a);
+    return band(cmpGt(a, splat(0.0f)), mul(mul(a2, a2), gradient));
+}
+
+NOISE_TARGET inline VF singleSimplex(int seedValue, VF x, VF y) {
+    const float SQRT3 = 1.7320508075688772935274463415059f;
+    const float G2 = (3 - SQRT3) / 6;
+    const float C1 = (float)(2 * (1 - 2 * G2) * (1 / G2 - 2));
+    const float C2 = (float)(-2 * (1 - 2 * G2) * (1 - 2 * G2));
+    const VI primeX = splat(FastNoiseBatch::PrimeX);
+    const VI primeY = splat(FastNoiseBatch::PrimeY);
+    VI seed = splat(seedValue);
+
+    VI i = fastFloor(x);
+    VI j = fastFloor(y);
+    VF xi = sub(x, toFloat(i));
+    VF yi = sub(y, toFloat(j));
+
+    VF t = mul(add(xi, yi), splat(G2));
+    VF x0 = sub(xi, t);
+    VF y0 = sub(yi, t);
+
+    i = mul(i, primeX);
+    j = mul(j, primeY);
+
+    VF a = sub(sub(splat(0.5f), mul(x0, x0)), mul(y0, y0));
+    VF n0 = falloff(a, gradCoord(seed, i, j, x0, y0));
+
+    VF c = add(mul(splat(C1), t), add(splat(C2), a));
+    VF x2 = add(x0, splat(2 * (float)G2 - 1));
+    VF y2 = add(y0, splat(2 * (float)G2 - 1));
+    VF n2 = falloff(c, gradCoord(seed, add(i, primeX), add(j, primeY), x2, y2));
+
+    VF upper = cmpGt(y0, x0);
+    VF x1 = add(x0, select(upper, splat((float)G2), splat((float)G2 - 1)));
+    VF y1 = add(y0, select(upper, splat((float)G2 - 1), splat((float)G2)));
+    VI i1 = select(upper, i, add(i, primeX));
+    VI j1 = select(upper, add(j, primeY), j);
+    VF b = sub(sub(splat(0.5f), mul(x1, x1)), mul(y1, y1));
+    VF n1 = falloff(b, gradCoord(seed, i1, j1, x1, y1));
+
+    return mul(add(add(n0, n1), n2), splat(99.83685446303647f));
+}
+
+NOISE_TARGET inline VF singleOpenSimplex2(int seedValue, VF x, VF y, VF z) {
+    const VI primeX = splat(FastNoiseBatch::PrimeX);
+    const VI primeY = splat(FastNoiseBatch::PrimeY);
+    const VI primeZ = splat(FastNoiseBatch::PrimeZ);
+    const VI one = splat(1);
+
+    VI i = fastRound(x);
+    VI j = fastRound(y);
+    VI k = fastRound(z);
+    VF x0 = sub(x, toFloat(i));
+    VF y0 = sub(y, toFloat(j));
+    VF z0 = sub(z, toFloat(k));
+
+    VI xNSign = bor(truncate(sub(splat(-1.0f), x0)), one);
+    VI yNSign = bor(truncate(sub(splat(-1.0f), y0)), one);
+    VI zNSign = bor(truncate(sub(splat(-1.0f), z0)), one);
+
+    VF ax0 = mul(toFloat(xNSign), vneg(x0));
+    VF ay0 = mul(toFloat(yNSign), vneg(y0));
+    VF az0 = mul(toFloat(zNSign), vneg(z0));
+
+    i = mul(i, primeX);
+    j = mul(j, primeY);
+    k = mul(k, primeZ);
+
+    VF value = splat(0.0f);
+    VF a = sub(sub(splat(0.6f), mul(x0, x0)), add(mul(y0, y0), mul(z0, z0)));
+
+    for (int l = 0; ; l++) {
+        VI seed = splat(seedValue);
+        value = add(value, falloff(a, gradCoord(seed, i, j, k, x0, y0, z0)));
+
+        // The scalar if / else if / else on the largest of ax0, ay0 and az0
+        VF alongX = band(cmpGe(ax0, ay0), cmpGe(ax0, az0));
+        VF alongY = bandNot(alongX, band(cmpGt(ay0, ax0), cmpGe(ay0, az0)));
+        VF notAlongZ = bor(alongX, alongY);
+
+        VF x1 = select(alongX, add(x0, toFloat(xNSign)), x0);
+        VF y1 = select(alongY, add(y0, toFloat(yNSign)), y0);
+        VF z1 = select(notAlongZ, z0, add(z0, toFloat(zNSign)));
+        VF step = select(alongX, mul(toFloat(add(xNSign, xNSign)), x1),
+                         select(alongY, mul(toFloat(add(yNSign, yNSign)), y1), mul(toFloat(add(zNSign, zNSign)), z1)));
+        VF b = sub(add(a, splat(1.0f)), step);
+        VI i1 = select(alongX, sub(i, mul(xNSign, primeX)), i);
+        VI j1 = select(alongY, sub(j, mul(yNSign, primeY)), j);
+        VI k1 = select(notAlongZ, k, sub(k, mul(zNSign, primeZ)));
+
+        value = add(value, falloff(b, gradCoord(seed, i1, j1, k1, x1, y1, z1)));
+
+        if (l == 1) break;
+
+        ax0 = sub(splat(0.5f), ax0);
+        ay0 = sub(splat(0.5f), ay0);
+        az0 = sub(splat(0.5f), az0);
+
+        x0 = mul(toFloat(xNSign), ax0);
+        y0 = mul(toFloat(yNSign), ay0);
+        z0 = mul(toFloat(zNSign), az0);
+
+        a = add(a, sub(sub(splat(0.75f), ax0), add(ay0, az0)));
+
+        // (sign >> 1) & prime is the prime where the sign is negative
+        i = add(i, band(asInt(cmpLt(toFloat(xNSign), splat(0.0f))), primeX));
+        j = add(j, band(asInt(cmpLt(toFloat(yNSign), splat(0.0f))), primeY));
+        k = add(k, band(asInt(cmpLt(toFloat(zNSign), splat(0.0f))), primeZ));
+
+        xNSign = sub(splat(0), xNSign);
+        yNSign = sub(splat(0), yNSign);
+        zNSign = sub(splat(0), zNSign);
+
+        seedValue = ~seedValue;
+    }
+
+    return mul(value, splat(32.69428253173828125f));
+}
+
+NOISE_TARGET inline VF singlePerlin(int seedValue, VF x, VF y) {
+    const VI primeX = splat(FastNoiseBatch::PrimeX);
+    const VI primeY = splat(FastNoiseBatch::PrimeY);
+    VI seed = splat(seedValue);
+
+    VI x0 = fastFloor(x);
+    VI y0 = fastFloor(y);
+
+    VF xd0 = sub(x, toFloat(x0));
+    VF yd0 = sub(y, toFloat(y0));
+    VF xd1 = sub(xd0, splat(1.0f));
+    VF yd1 = sub(yd0, splat(1.0f));
+
+    VF xs = interpQuintic(xd0);
+    VF ys = interpQuintic(yd0);
+
+    x0 = mul(x0, primeX);
+    y0 = mul(y0, primeY);
+    VI x1 = add(x0, primeX);
+    VI y1 = add(y0, primeY);
+
+    VF xf0 = lerp(gradCoord(seed, x0, y0, xd0, yd0), gradCoord(seed, x1, y0, xd1, yd0), xs);
+    VF xf1 = lerp(gradCoord(seed, x0, y1, xd0, yd1), gradCoord(seed, x1, y1, xd1, yd1), xs);
+
+    return mul(lerp(xf0, xf1, ys), splat(1.4247691104677813f));
+}
+
+NOISE_TARGET inline VF singlePerlin(int seedValue, VF x, VF y, VF z) {
+    const VI primeX = splat(FastNoiseBatch::PrimeX);
+    const VI primeY = splat(FastNoiseBatch::PrimeY);
+    const VI primeZ = splat(FastNoiseBatch::PrimeZ);
+    VI seed = splat(seedValue);
+
+    VI x0 = fastFloor(x);
+    VI y0 = fastFloor(y);
+    VI z0 = fastFloor(z);
+
+    VF xd0 = sub(x, toFloat(x0));
+    VF yd0 = sub(y, toFloat(y0));
+    VF zd0 = sub(z, toFloat(z0));
+    VF xd1 = sub(xd0, splat(1.0f));
+    VF yd1 = sub(yd0, splat(1.0f));
+    VF zd1 = sub(zd0, splat(1.0f));
+
+    VF xs = interpQuintic(xd0);
+    VF ys = interpQuintic(yd0);
+    VF zs = interpQuintic(zd0);
+
+    x0 = mul(x0, primeX);
+    y0 = mul(y0, primeY);
+    z0 = mul(z0, primeZ);
+    VI x1 = add(x0, primeX);
+    VI y1 = add(y0, primeY);
+    VI z1 = add(z0, primeZ);
+
+    VF xf00 = lerp(gradCoord(seed, x0, y0, z0, xd0, yd0, zd0), gradCoord(seed, x1, y0, z0, xd1, yd0, zd0), xs);
+    VF xf10 = lerp(gradCoord(seed, x0, y1, z0, xd0, yd1, zd0), gradCoord(seed, x1, y1, z0, xd1, yd1, zd0), xs);
+    VF xf01 = lerp(gradCoord(seed, x0, y0, z1, xd0, yd0, zd1), gradCoord(seed, x1, y0, z1, xd1, yd0, zd1), xs);
+    VF xf11 = lerp(gradCoord(seed, x0, y1, z1, xd0, yd1, zd1), gradCoord(seed, x1, y1, z1, xd1, yd1, zd1), xs);
+
+    VF yf0 = lerp(xf00, xf10, ys);
+    VF yf1 = lerp(xf01, xf11, ys);
+
+    return mul(lerp(yf0, yf1, zs), splat(0.964921414852142333984375f));
+}
+
+NOISE_TARGET inline VF cellularDistance(FastNoiseLite::CellularDistanceFunction function, VF vecX, VF vecY) {
+    switch (function) {
+        case FastNoiseLite::CellularDistanceFunction_Manhattan:
+            return add(fastAbs(vecX), fastAbs(vecY));
+        case FastNoiseLite::CellularDistanceFunction_Hybrid:
+            return add(add(fastAbs(vecX), fastAbs(vecY)), add(mul(vecX, vecX), mul(vecY, vecY)));
+        default:
+            return add(mul(vecX, vecX), mul(vecY, vecY));
+    }
+}
+
+NOISE_TARGET inline VF cellularDistance(FastNoiseLite::CellularDistanceFunction function, VF vecX, VF vecY, VF vecZ) {
+    switch (function) {
+        case FastNoiseLite::CellularDistanceFunction_Manhattan:
+            return add(add(fastAbs(vecX), fastAbs(vecY)), fastAbs(vecZ));
+        case FastNoiseLite::CellularDistanceFunction_Hybrid:
+            return add(add(add(fastAbs(vecX), fastAbs(vecY)), fastAbs(vecZ)),
+                       add(add(mul(vecX, vecX), mul(vecY, vecY)), mul(vecZ, vecZ)));
+        default:
+            return add(add(mul(vecX, vecX), mul(vecY, vecY)), mul(vecZ, vecZ));
+    }
+}
+
+NOISE_TARGET inline VF cellularResult(const NoiseBatchSettings& s, VF distance0, VF distance1, VI closestHash) {
+    if (s.distanceFunction == FastNoiseLite::CellularDistanceFunction_Euclidean &&
+        s.returnType >= FastNoiseLite::CellularReturnType_Distance) {
+        distance0 = vsqrt(distance0);
+        if (s.returnType >= FastNoiseLite::CellularReturnType_Distance2) {
+            distance1 = vsqrt(distance1);
+        }
+    }
+
+    const VF one = splat(1.0f);
+    switch (s.returnType) {
+        case FastNoiseLite::CellularReturnType_CellValue:
+            return mul(toFloat(closestHash), splat(1 / 2147483648.0f));
+        case FastNoiseLite::CellularReturnType_Distance:
+            return sub(distance0, one);
+        case FastNoiseLite::CellularReturnType_Distance2:
+            return sub(distance1, one);
+        case FastNoiseLite::CellularReturnType_Distance2Add:
+            return sub(mul(add(distance1, distance0), splat(0.5f)), one);
+        case FastNoiseLite::CellularReturnType_Distance2Sub:
+            return sub(sub(distance1, distance0), one);
+        case FastNoiseLite::CellularReturnType_Distance2Mul:
+            return sub(mul(mul(distance1, distance0), splat(0.5f)), one);
+        case FastNoiseLite::CellularReturnType_Distance2Div:
+            return sub(div(distance0, distance1), one);
+        default:
+            return splat(0.0f);
+    }
+}
+
+NOISE_TARGET inline VF singleCellular(const NoiseBatchSettings& s, int seedValue, VF x, VF y) {
+    const VI primeX = splat(FastNoiseBatch::PrimeX);
+    const VI primeY = splat(FastNoiseBatch::PrimeY);
+    const float* randVecs = FastNoiseBatch::randVecs2D();
+    VI seed = splat(seedValue);
+
+    VI xr = fastRound(x);
+    VI yr = fastRound(y);
+
+    VF distance0 = splat(1e10f);
+    VF distance1 = splat(1e10f);
+    VI closestHash = splat(0);
+
+    VF cellularJitter = splat(0.43701595f * s.jitter);
+
+    VI xPrimed = mul(sub(xr, splat(1)), primeX);
+    VI yPrimedBase = mul(sub(yr, splat(1)), primeY);
+
+    for (int dx = -1; dx <= 1; dx++) {
+        VF xi = toFloat(add(xr, splat(dx)));
+        VI yPrimed = yPrimedBase;
+
+        for (int dy = -1; dy <= 1; dy++) {
+            VF yi = toFloat(add(yr, splat(dy)));
+            VI h = hash(seed, xPrimed, yPrimed);
+            VI idx = band(h, splat(255 << 1));
+
+            VF vecX = add(sub(xi, x), mul(gather(randVecs, idx), cellularJitter));
+            VF vecY = add(sub(yi, y), mul(gather(randVecs, bor(idx, splat(1))), cellularJitter));
+
+            VF newDistance = cellularDistance(s.distanceFunction, vecX, vecY);
+
+            distance1 = vmax(vmin(distance1, newDistance), distance0);
+            VF closer = cmpLt(newDistance, distance0);
+            distance0 = select(closer, newDistance, distance0);
+            closestHash = select(closer, h, closestHash);
+            yPrimed = add(yPrimed, primeY);
+        }
+        xPrimed = add(xPrimed, primeX);
+    }
+
+    return cellularResult(s, distance0, distance1, closestHash);
+}
+
+NOISE_TARGET inline VF singleCellular(const NoiseBatchSettings& s, int seedValue, VF x, VF y, VF z) {
+    const VI primeX = splat(FastNoiseBatch::PrimeX);
+    const VI primeY = splat(FastNoiseBatch::PrimeY);
+    const VI primeZ = splat(FastNoiseBatch::PrimeZ);
+    const float* randVecs = FastNoiseBatch::randVecs3D();
+    VI seed = splat(seedValue);
+
+    VI xr = fastRound(x);
+    VI yr = fastRound(y);
+    VI zr = fastRound(z);
+
+    VF distance0 = splat(1e10f);
+    VF distance1 = splat(1e10f);
+    VI closestHash = splat(0);
+
+    VF cellularJitter = splat(0.39614353f * s.jitter);
+
+    VI xPrimed = mul(sub(xr, splat(1)), primeX);
+    VI yPrimedBase = mul(sub(yr, splat(1)), primeY);
+    VI zPrimedBase = mul(sub(zr, splat(1)), primeZ);
+
+    for (int dx = -1; dx <= 1; dx++) {
+        VF xi = toFloat(add(xr, splat(dx)));
+        VI yPrimed = yPrimedBase;
+
+        for (int dy = -1; dy <= 1; dy++) {
+            VF yi = toFloat(add(yr, splat(dy)));
+            VI zPrimed = zPrimedBase;
+
+            for (int dz = -1; dz <= 1; dz++) {
+                VF zi = toFloat(add(zr, splat(dz)));
+                VI h = hash(seed, xPrimed, yPrimed, zPrimed);
+                VI idx = band(h, splat(255 << 2));
+
+                VF vecX = add(sub(xi, x), mul(gather(randVecs, idx), cellularJitter));
+                VF vecY = add(sub(yi, y), mul(gather(randVecs, bor(idx, splat(1))), cellularJitter));
+                VF vecZ = add(sub(zi, z), mul(gather(randVecs, bor(idx, splat(2))), cellularJitter));
+
+                VF newDistance = cellularDistance(s.distanceFunction, vecX, vecY, vecZ);
+
+                distance1 = vmax(vmin(distance1, newDistance), distance0);
+                VF closer = cmpLt(newDistance, distance0);
+                distance0 = select(closer, newDistance, distance0);
+                closestHash = select(closer, h, closestHash);
+                zPrimed = add(zPrimed, primeZ);
+            }
+            yPrimed = add(yPrimed, primeY);
+        }
+        xPrimed = add(xPrimed, primeX);
+    }
+
+    return cellularResult(s, distance0, distance1, closestHash);
+}
+
+NOISE_TARGET inline VF genNoiseSingle(const NoiseBatchSettings& s, int seed, VF x, VF y) {
+    switch (s.noiseType) {
+        case FastNoiseLite::NoiseType_OpenSimplex2: return singleSimplex(seed, x, y);
+        case FastNoiseLite::NoiseType_Perlin: return singlePerlin(seed, x, y);
+        default: return singleCellular(s, seed, x, y);
+    }
+}
+
+NOISE_TARGET inline VF genNoiseSingle(const NoiseBatchSettings& s, int seed, VF x, VF y, VF z) {
+    switch (s.noiseType) {
+        case FastNoiseLite::NoiseType_OpenSimplex2: return singleOpenSimplex2(seed, x, y, z);
+        case FastNoiseLite::NoiseType_Perlin: return singlePerlin(seed, x, y, z);
+        default: return singleCellular(s, seed, x, y, z);
+    }
+}
+
+// GetNoise(x, y) for one vector of samples
+NOISE_TARGET inline VF getNoise(const NoiseBatchSettings& s, VF x, VF y) {
+    x = mul(x, splat(s.frequency));
+    y = mul(y, splat(s.frequency));
+    if (s.noiseType == FastNoiseLite::NoiseType_OpenSimplex2) {
+        const float SQRT3 = (float)1.7320508075688772935274463415059;
+        const float F2 = 0.5f * (SQRT3 - 1);
+        VF t = mul(add(x, y), splat(F2));
+        x = add(x, t);
+        y = add(y, t);
+    }
+
+    if (!s.fbm) {
+        return genNoiseSingle(s, s.seed, x, y);
+    }
+
+    int seed = s.seed;
+    VF sum = splat(0.0f);
+    VF amp = splat(s.fractalBounding);
+    for (int i = 0; i < s.octaves; i++) {
+        VF noise = genNoiseSingle(s, seed++, x, y);
+        sum = add(sum, mul(noise, amp));
+        VF weight = mul(vmin(add(noise, splat(1.0f)), splat(2.0f)), splat(0.5f));
+        amp = mul(amp, lerp(splat(1.0f), weight, splat(s.weightedStrength)));
+
+        x = mul(x, splat(s.lacunarity));
+        y = mul(y, splat(s.lacunarity));
+        amp = mul(amp, splat(s.gain));
+    }
+    return sum;
+}
+
+// GetNoise(x, y, z) for one vector of samples
+NOISE_TARGET inline VF getNoise(const NoiseBatchSettings& s, VF x, VF y, VF z) {
+    x = mul(x, splat(s.frequency));
+    y = mul(y, splat(s.frequency));
+    z = mul(z, splat(s.frequency));
+
+    switch (s.transform3D) {
+        case NoiseTransform3D::IMPROVE_XY_PLANES: {
+            VF xy = add(x, y);
+            VF s2 = mul(xy, splat(-(float)0.211324865405187));
+            z = mul(z, splat((float)0.577350269189626));
+            x = add(x, sub(s2, z));
+            y = sub(add(y, s2), z);
+            z = add(z, mul(xy, splat((float)0.577350269189626)));
+            break;
+        }
+        case NoiseTransform3D::IMPROVE_XZ_PLANES: {
+            VF xz = add(x, z);
+            VF s2 = mul(xz, splat(-(float)0.211324865405187));
+            y = mul(y, splat((float)0.577350269189626));
+            x = add(x, sub(s2, y));
+            z = add(z, sub(s2, y));
+            y = add(y, mul(xz, splat((float)0.577350269189626)));
+            break;
+        }
+        case NoiseTransform3D::OPENSIMPLEX2: {
+            VF r = mul(add(add(x, y), z), splat((float)(2.0 / 3.0)));
+            x = sub(r, x);
+            y = sub(r, y);
+            z = sub(r, z);
+            break;
+        }
+        default:
+            break;
+    }
+
+    if (!s.fbm) {
+        return genNoiseSingle(s, s.seed, x, y, z);
+    }
+
+    int seed = s.seed;
+    VF sum = splat(0.0f);
+    VF amp = splat(s.fractalBounding);
+    for (int i = 0; i < s.octaves; i++) {
+        VF noise = genNoiseSingle(s, seed++, x, y, z);
+        sum = add(sum, mul(noise, amp));
+        VF weight = mul(add(noise, splat(1.0f)), splat(0.5f));
+        amp = mul(amp, lerp(splat(1.0f), weight, splat(s.weightedStrength)));
+
+        x = mul(x, splat(s.lacunarity));
+        y = mul(y, splat(s.lacunarity));
+        z = mul(z, splat(s.lacunarity));
+        amp = mul(amp, splat(s.gain));
+    }
+    return sum;
+}
+
+// Whole vectors first; the last partial one goes through a zero-padded copy
+NOISE_TARGET inline void noiseBatch2D(const NoiseBatchSettings& s, const float* x, const float* y, float* out, size_t count) {
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        store(out + i, getNoise(s, load(x + i), load(y + i)));
+    }
+    if (i < count) {
+        float tailX[LANES] = {}, tailY[LANES] = {}, tailOut[LANES];
+        for (size_t l = 0; l < count - i; ++l) {
+            tailX[l] = x[i + l];
+            tailY[l] = y[i + l];
+        }
+        store(tailOut, getNoise(s, load(tailX), load(tailY)));
+        for (size_t l = 0; l < count - i; ++l) {
+            out[i + l] = tailOut[l];
+        }
+    }
+}
+
+NOISE_TARGET inline void noiseBatch3D(const NoiseBatchSettings& s, const float* x, const float* y, const float* z, float* out, size_t count) {
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        store(out + i, getNoise(s, load(x + i), load(y + i), load(z + i)));
+    }
+    if (i < count) {
+        float tailX[LANES] = {}, tailY[LANES] = {}, tailZ[LANES] = {}, tailOut[LANES];
+        for (size_t l = 0; l < count - i; ++l) {
+            tailX[l] = x[i + l];
+            tailY[l] = y[i + l];
+            tailZ[l] = z[i + l];
+        }
+        store(tailOut, getNoise(s, load(tailX), load(tailY), load(tailZ)));
+        for (size_t l = 0; l < count - i; ++l) {
+            out[i + l] = tailOut[l];
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <SDL.h>
+#include <cstring>
+#include "framebuffer.h"
+
+// Copies the color plane into a top-down ARGB8888 image with the given row
+// pitch. The framebuffer is stored bottom-up; only the row order is reversed.
+void copyFramebufferRows(const Framebuffer& source, Uint8* destination, size_t pitch) {
+    size_t rowBytes = source.width * sizeof(Uint32);
+    for (size_t y = 0; y < source.height; y++) {
+        size_t framebufferY = source.height - y - 1;
+        std::memcpy(destination + y * pitch, &source.color[framebufferY * source.width], rowBytes);
+    }
+}
+
+// Copies the framebuffer to the window. The streaming texture is created once
+// (and again only when the framebuffer changes size) with the same ARGB8888
+// layout as the color plane, so presenting a frame is one memcpy per row.
+class Presenter {
+public:
+    Presenter() = default;
+    Presenter(const Presenter&) = delete;
+    Presenter& operator=(const Presenter&) = delete;
+
+    ~Presenter() {
+        destroy();
+    }
+
+    bool create(SDL_Renderer* target) {
+        renderer = target;
+        return resize(framebuffer.width, framebuffer.height);
+    }
+
+    // Must run before the renderer is destroyed
+    void destroy() {
+        if (texture) {
+            SDL_DestroyTexture(texture);
+        }
+        texture = nullptr;
+        width = 0;
+        height = 0;
+    }
+
+    void present(const Framebuffer& source) {
+        if (!resize(source.width, source.height)) {
+            return;
+        }
+
+        void* texturePixels;
+        int pitch;
+        if (SDL_LockTexture(texture, NULL, &texturePixels, &pitch) != 0) {
+            return;
+        }
+
+        copyFramebufferRows(source, static_cast<Uint8*>(texturePixels), pitch);
+
+        SDL_UnlockTexture(texture);
+        // Stretched over the whole window, so a low preview resolution still fills it
+        SDL_RenderCopy(renderer, texture, NULL, NULL);
+        SDL_RenderPresent(renderer);
+    }
+
+private:
+    bool resize(size_t newWidth, size_t newHeight) {
+        if (texture && newWidth == width && newHeight == height) {
+            return true;
+        }
+        destroy();
+
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                    static_cast<int>(newWidth), static_cast<int>(newHeight));
+        if (!texture) {
+            return false;
+        }
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        width = newWidth;
+        height = newHeight;
+        return true;
+    }
+
+    SDL_Renderer* renderer = nullptr;
+    SDL_Texture* texture = nullptr;
+    size_t width = 0;
+    size_t height = 0;
+};
@@ -0,0 +1,365 @@
+#pragma once
+#include <SDL.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "framebuffer.h"
+#include "uniforms.h"
+
+// Frame profiler. Stage times are wall-clock time measured on the main thread,
+// except SHADE, which is the fragment shader time summed over every thread (so
+// it can exceed the frame time on a multi-core machine). Counters are kept per
+// thread and added up when the frame ends, so the hot loops never share a
+// cache line. Clocks are only read while profilingEnabled is set.
+
+enum class ProfileStage {
+    STARS,
+    ORBIT,
+    VERTEX,
+    BINNING,
+    RASTER,   // tile pass; in forward mode it also runs the fragment shader
+    SHADE,
+    RESOLVE,  // deferred shading pass
+    PRESENT,
+    COUNT
+};
+
+constexpr size_t PROFILE_STAGE_COUNT = static_cast<size_t>(ProfileStage::COUNT);
+
+inline const char* profileStageName(ProfileStage stage) {
+    switch (stage) {
+        case ProfileStage::STARS: return "stars";
+        case ProfileStage::ORBIT: return "orbit";
+        case ProfileStage::VERTEX: return "vertex";
+        case ProfileStage::BINNING: return "binning";
+        case ProfileStage::RASTER: return "raster";
+        case ProfileStage::SHADE: return "shade";
+        case ProfileStage::RESOLVE: return "resolve";
+        case ProfileStage::PRESENT: return "present";
+        default: return "?";
+    }
+}
+
+// Planets are identified by their ObjectType; the planet types come first
+constexpr size_t PROFILE_PLANET_COUNT = static_cast<size_t>(ObjectType::ORBIT);
+
+inline const char* planetName(ObjectType type) {
+    switch (type) {
+        case ObjectType::SOL: return "sol";
+        case ObjectType::MARS: return "mars";
+        case ObjectType::EARTH: return "earth";
+        case ObjectType::VENUS: return "venus";
+        case ObjectType::SATURN: return "saturn";
+        default: return "?";
+    }
+}
+
+struct ProfileCounters {
+    uint64_t trianglesSubmitted = 0;
+    uint64_t trianglesCulled = 0;      // back-facing, outside the screen, degenerate or not projectable
+    uint64_t tileTrianglesOccluded = 0;  // (tile, triangle) pairs rejected by the hierarchical Z
+    uint64_t fragmentsGenerated = 0;   // covered samples that came out of the rasterizer
+    uint64_t fragmentsShaded = 0;
+    uint64_t fragmentsWritten = 0;     // passed the depth test and reached the framebuffer
+    uint64_t pixelsCovered = 0;        // pixels the planets wrote for the first time this frame
+    uint64_t shadeNanoseconds = 0;
+    uint64_t objectsCulled = 0;        // draws skipped whole because their bounding sphere is off screen
+
+    void add(const ProfileCounters& other) {
+        trianglesSubmitted += other.trianglesSubmitted;
+        trianglesCulled += other.trianglesCulled;
+        tileTrianglesOccluded += other.tileTrianglesOccluded;
+        fragmentsGenerated += other.fragmentsGenerated;
+        fragmentsShaded += other.fragmentsShaded;
+        fragmentsWritten += other.fragmentsWritten;
+        pixelsCovered += other.pixelsCovered;
+        shadeNanoseconds += other.shadeNanoseconds;
+        objectsCulled += other.objectsCulled;
+    }
+};
+
+struct FrameProfile {
+    double frameMs = 0.0;
+    std::array<double, PROFILE_STAGE_COUNT> stageMs{};
+    std::array<double, PROFILE_PLANET_COUNT> planetMs{};  // orbit + render() of each planet
+    ProfileCounters counters;
+
+    // Shaded fragments per covered pixel
+    double overdraw() const {
+        return counters.pixelsCovered ? static_cast<double>(counters.fragmentsShaded) / counters.pixelsCovered : 0.0;
+    }
+};
+
+using ProfileClock = std::chrono::steady_clock;
+
+bool profilingEnabled = false;
+
+// Frames kept when the history is not going to be written out: about ten
+// seconds at 60 FPS, so a window left profiling does not grow without bound
+constexpr size_t PROFILE_RING_FRAMES = 600;
+
+class Profiler {
+public:
+    // Counters of the calling thread. Only touched by that thread during a
+    // frame and read by the main thread after all work of the frame finished.
+    ProfileCounters& threadCounters() {
+        thread_local ProfileCounters* counters = nullptr;
+        if (!counters) {
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.push_back(std::make_unique<ProfileCounters>());
+            counters = threads.back().get();
+        }
+        return *counters;
+    }
+
+    void beginFrame() {
+        current = FrameProfile();
+        frameStart = ProfileClock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::unique_ptr<ProfileCounters>& counters : threads) {
+            *counters = ProfileCounters();
+        }
+    }
+
+    void endFrame() {
+        current.frameMs = milliseconds(frameStart, ProfileClock::now());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const std::unique_ptr<ProfileCounters>& counters : threads) {
+                current.counters.add(*counters);
+            }
+        }
+        current.stageMs[static_cast<size_t>(ProfileStage::SHADE)] = current.counters.shadeNanoseconds / 1e6;
+        if (historyCapacity == 0 || frames.size() < historyCapacity) {
+            frames.push_back(current);
+        } else {
+            frames[recorded % historyCapacity] = current;
+        }
+        recorded++;
+    }
+
+    // 0 keeps every frame; otherwise only the last capacity frames, in a ring
+    void setHistoryCapacity(size_t capacity) {
+        historyCapacity = capacity;
+        frames.clear();
+        recorded = 0;
+    }
+
+    void addStage(ProfileStage stage, double ms) {
+        current.stageMs[static_cast<size_t>(stage)] += ms;
+    }
+
+    void addPlanet(ObjectType type, double ms) {
+        if (static_cast<size_t>(type) < PROFILE_PLANET_COUNT) {
+            current.planetMs[static_cast<size_t>(type)] += ms;
+        }
+    }
+
+    // The frames kept, oldest first
+    std::vector<FrameProfile> history() const {
+        if (historyCapacity == 0 || frames.size() < historyCapacity) {
+            return frames;
+        }
+        size_t oldest = recorded % historyCapacity;
+        std::vector<FrameProfile> ordered(frames.begin() + oldest, frames.end());
+        ordered.insert(ordered.end(), frames.begin(), frames.begin() + oldest);
+        return ordered;
+    }
+
+    const FrameProfile* lastFrame() const {
+        return frames.empty() ? nullptr : &frames[(recorded - 1) % frames.size()];
+    }
+
+    static double milliseconds(ProfileClock::time_point start, ProfileClock::time_point end) {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ProfileCounters>> threads;
+    std::vector<FrameProfile> frames;
+    size_t historyCapacity = 0;
+    size_t recorded = 0;  // frames ever ended; the ring slot of the next one
+    FrameProfile current;
+    ProfileClock::time_point frameStart;
+};
+
+Profiler profiler;
+
+inline ProfileCounters& threadCounters() {
+    return profiler.threadCounters();
+}
+
+// Adds the time until the end of the scope to a stage of the current frame
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileStage stage) : stage(stage), start(profilingEnabled ? ProfileClock::now() : ProfileClock::time_point()) {}
+
+    ~ProfileScope() {
+        if (profilingEnabled) {
+            profiler.addStage(stage, Profiler::milliseconds(start, ProfileClock::now()));
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfileStage stage;
+    ProfileClock::time_point start;
+};
+
+// Runs shade() and, when profiling, adds its duration to the thread's counters
+template <typename Shade>
+void profileShade(ProfileCounters& counters, Shade&& shade) {
+    counters.fragmentsShaded++;
+    if (!profilingEnabled) {
+        shade();
+        return;
+    }
+    ProfileClock::time_point start = ProfileClock::now();
+    shade();
+    counters.shadeNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(ProfileClock::now() - start).count();
+}
+
+// One row per frame: frame, frame_ms, <stage>_ms..., <planet>_ms..., counters, overdraw
+bool writeProfileCSV(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    std::fprintf(file, "frame,frame_ms");
+    for (size_t s = 0; s < PROFILE_STAGE_COUNT; ++s) {
+        std::fprintf(file, ",%s_ms", profileStageName(static_cast<ProfileStage>(s)));
+    }
+    for (size_t p = 0; p < PROFILE_PLANET_COUNT; ++p) {
+        std::fprintf(file, ",planet_%s_ms", planetName(static_cast<ObjectType>(p)));
+    }
+    std::fprintf(file, ",triangles_submitted,triangles_culled,tile_triangles_occluded"
+                       ",fragments_generated,fragments_shaded,fragments_written,pixels_covered,overdraw,objects_culled\n");
+
+    std::vector<FrameProfile> frames = profiler.history();
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const FrameProfile& frame = frames[i];
+        std::fprintf(file, "%zu,%.4f", i, frame.frameMs);
+        for (double ms : frame.stageMs) {
+            std::fprintf(file, ",%.4f", ms);
+        }
+        for (double ms : frame.planetMs) {
+            std::fprintf(file, ",%.4f", ms);
+        }
+        const ProfileCounters& c = frame.counters;
+        std::fprintf(file, ",%llu,%llu,%llu,%llu,%llu,%llu,%llu,%.3f,%llu\n",
+                     (unsigned long long)c.trianglesSubmitted, (unsigned long long)c.trianglesCulled,
+                     (unsigned long long)c.tileTrianglesOccluded, (unsigned long long)c.fragmentsGenerated,
+                     (unsigned long long)c.fragmentsShaded, (unsigned long long)c.fragmentsWritten,
+                     (unsigned long long)c.pixelsCovered, frame.overdraw(), (unsigned long long)c.objectsCulled);
+    }
+    return std::fclose(file) == 0;
+}
+
+// {"frames": [{"frame_ms": ..., "stages_ms": {...}, "planets_ms": {...}, "counters": {...}}, ...]}
+bool writeProfileJSON(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    std::fprintf(file, "{\"frames\": [\n");
+    std::vector<FrameProfile> frames = profiler.history();
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const FrameProfile& frame = frames[i];
+        std::fprintf(file, "  {\"frame\": %zu, \"frame_ms\": %.4f, \"stages_ms\": {", i, frame.frameMs);
+        for (size_t s = 0; s < PROFILE_STAGE_COUNT; ++s) {
+            std::fprintf(file, "%s\"%s\": %.4f", s ? ", " : "", profileStageName(static_cast<ProfileStage>(s)), frame.stageMs[s]);
+        }
+        std::fprintf(file, "}, \"planets_ms\": {");
+        for (size_t p = 0; p < PROFILE_PLANET_COUNT; ++p) {
+            std::fprintf(file, "%s\"%s\": %.4f", p ? ", " : "", planetName(static_cast<ObjectType>(p)), frame.planetMs[p]);
+        }
+        const ProfileCounters& c = frame.counters;
+        std::fprintf(file, "}, \"counters\": {\"triangles_submitted\": %llu, \"triangles_culled\": %llu, "
+                           "\"tile_triangles_occluded\": %llu, \"fragments_generated\": %llu, "
+                           "\"fragments_shaded\": %llu, \"fragments_written\": %llu, \"pixels_covered\": %llu, "
+                           "\"overdraw\": %.3f, \"objects_culled\": %llu}}%s\n",
+                     (unsigned long long)c.trianglesSubmitted, (unsigned long long)c.trianglesCulled,
+                     (unsigned long long)c.tileTrianglesOccluded, (unsigned long long)c.fragmentsGenerated,
+                     (unsigned long long)c.fragmentsShaded, (unsigned long long)c.fragmentsWritten,
+                     (unsigned long long)c.pixelsCovered, frame.overdraw(), (unsigned long long)c.objectsCulled,
+                     i + 1 < frames.size() ? "," : "");
+    }
+    std::fprintf(file, "]}\n");
+    return std::fclose(file) == 0;
+}
+
+// Picks the format from the extension (.json, anything else is CSV)
+bool writeProfile(const std::string& path) {
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    return json ? writeProfileJSON(path) : writeProfileCSV(path);
+}
+
+// Short text for the window title
+std::string profileSummary(const FrameProfile& frame) {
+    char text[256];
+    int length = std::snprintf(text, sizeof(text), "%.2f ms |", frame.frameMs);
+    for (size_t s = 0; s < PROFILE_STAGE_COUNT && length < static_cast<int>(sizeof(text)); ++s) {
+        length += std::snprintf(text + length, sizeof(text) - length, " %s %.2f",
+                                profileStageName(static_cast<ProfileStage>(s)), frame.stageMs[s]);
+    }
+    if (length < static_cast<int>(sizeof(text))) {
+        std::snprintf(text + length, sizeof(text) - length, " | overdraw %.2f", frame.overdraw());
+    }
+    return text;
+}
+
+const std::array<Color, PROFILE_STAGE_COUNT> PROFILE_STAGE_COLORS = {
+    Color(255, 255, 255),  // stars
+    Color(160, 160, 160),  // orbit
+    Color(80, 160, 255),   // vertex
+    Color(0, 220, 220),    // binning
+    Color(80, 220, 80),    // raster
+    Color(255, 200, 0),    // shade
+    Color(255, 120, 0),    // resolve
+    Color(220, 60, 220)    // present
+};
+
+// Draws one bar per stage in the top-left corner, 1 pixel per 0.1 ms, with a
+// mark at 16.7 ms. Written straight into the color plane after the frame.
+void drawProfileOverlay(const FrameProfile& frame) {
+    constexpr int BAR_HEIGHT = 6;
+    constexpr int BAR_GAP = 2;
+    constexpr double PIXELS_PER_MS = 10.0;
+    constexpr double BUDGET_MS = 1000.0 / 60.0;
+
+    int width = static_cast<int>(framebuffer.width);
+    int height = static_cast<int>(framebuffer.height);
+    auto fillRow = [&](int top, int length, Uint32 color) {
+        length = std::min(length, width - 4);
+        for (int y = top; y < top + BAR_HEIGHT && y < height; ++y) {
+            // The framebuffer is stored bottom-up
+            Uint32* row = &framebuffer.color[framebuffer.index(0, height - 1 - y)];
+            std::fill(row + 4, row + 4 + std::max(length, 0), color);
+        }
+    };
+
+    int top = 4;
+    for (size_t s = 0; s < PROFILE_STAGE_COUNT; ++s) {
+        fillRow(top, static_cast<int>(frame.stageMs[s] * PIXELS_PER_MS), PROFILE_STAGE_COLORS[s].toARGB());
+        top += BAR_HEIGHT + BAR_GAP;
+    }
+
+    int budgetX = 4 + static_cast<int>(BUDGET_MS * PIXELS_PER_MS);
+    if (budgetX < width) {
+        Uint32 red = Color(255, 0, 0).toARGB();
+        for (int y = 4; y < top && y < height; ++y) {
+            framebuffer.color[framebuffer.index(budgetX, height - 1 - y)] = red;
+        }
+    }
+}
@@ -0,0 +1,391 @@
+#pragma once
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "assembly.h"
+#include "bake.h"
+#include "camera.h"
+#include "color.h"
+#include "fragment.h"
+#include "framebuffer.h"
+#include "frustum.h"
+#include "hiz.h"
+#include "line.h"
+#include "mesh.h"
+#include "noise.h"
+#include "profiler.h"
+#include "trace.h"
+#include "shaders.h"
+#include "threadpool.h"
+#include "tiles.h"
+#include "triangle.h"
+#include "uniforms.h"
+#include "vertex_simd.h"
+#include "visibility.h"
+
+// Everything needed to draw one frame of the solar system into the
+// framebuffer, shared by the interactive window, the headless mode and the
+// benchmarks. Nothing here talks to SDL's video subsystem.
+
+ThreadPool threadPool;
+
+// La simulacion avanza un paso fijo por frame, sin depender del reloj
+constexpr float FIXED_DELTA_TIME = 0.2f;
+constexpr float FOV_DEGREES = 45.0f;
+constexpr float NEAR_CLIP = 0.1f;
+constexpr float FAR_CLIP = 100.0f;
+
+void shadeFragment(Fragment& fragment, ObjectType objectType) {
+    if (shadeBaked(fragment, objectType)) {
+        return;
+    }
+    if (objectType == ObjectType::SOL) {
+        fragmentShaderSun(fragment, shaderNoise.sun);
+    } else if (objectType == ObjectType::MARS) {
+        fragmentShaderMars(fragment, shaderNoise.mars);
+    } else if (objectType == ObjectType::EARTH) {
+        fragmentShaderEarth(fragment, shaderNoise.earth);
+    } else if (objectType == ObjectType::VENUS) {
+        fragmentShaderVenus(fragment, shaderNoise.venus);
+    }
+    // Saturn keeps the color from the rasterizer: fragmentShaderSaturn() takes
+    // the fragment by value and its result was never used, so it is not called
+}
+
+void transformVertices(const Mesh& mesh, const Uniforms& uniforms, std::vector<Vertex>& transformedVertices) {
+    ProfileScope scope(ProfileStage::VERTEX);
+    TRACE_SCOPE("vertex");
+    transformedVertices.resize(mesh.vertexCount);
+    // Once per draw, not once per vertex
+    VertexTransform transform = vertexTransform(uniforms);
+
+    constexpr size_t VERTEX_BATCH = 1024;
+    size_t vertexBatches = (transformedVertices.size() + VERTEX_BATCH - 1) / VERTEX_BATCH;
+    threadPool.parallelFor(vertexBatches, [&](size_t batch) {
+        TRACE_SCOPE("vertex batch");
+        size_t begin = batch * VERTEX_BATCH;
+        size_t end = std::min(transformedVertices.size(), begin + VERTEX_BATCH);
+#if SIMD_X86
+        if (simdLevel == SimdLevel::AVX2) {
+            transformVerticesAVX2(mesh.positions, mesh.normals, mesh.texCoords, begin, end,
+                                  transform, transformedVertices.data());
+            return;
+        }
+#endif
+        for (size_t i = begin; i < end; ++i) {
+            transformedVertices[i] = vertexShader(vertexInput(mesh.positions, mesh.normals, mesh.texCoords, i), transform);
+        }
+    });
+}
+
+// Clips, culls and bins the triangles of the mesh into tiles (vertices made by
+// clipping are appended to transformedVertices, the assembled triangles go to
+// triangles) and calls rasterize(tile, triangleIndex, earlyZ, writtenBlocks)
+// for each one that the hierarchical Z test cannot reject. triangleIndex
+// refers to triangles. Each tile is handled by exactly one thread.
+template <typename Rasterize>
+void rasterizeTiles(const Mesh& mesh, const Uniforms& uniforms, std::vector<Vertex>& transformedVertices,
+                    std::vector<uint32_t>& triangles, Rasterize&& rasterize) {
+    size_t dropped;
+    size_t binned;
+    {
+        ProfileScope scope(ProfileStage::BINNING);
+        TRACE_SCOPE("binning");
+        dropped = assembleTriangles(mesh, uniforms.viewport, transformedVertices, triangles);
+        binned = binTriangles(transformedVertices, triangles);
+    }
+    // Clipping can split a triangle, so the ones that never reach a tile are counted after assembly
+    ProfileCounters& counters = threadCounters();
+    counters.trianglesSubmitted += mesh.triangleCount();
+    counters.trianglesCulled += dropped + (triangles.size() / 3 - binned);
+
+    ProfileScope scope(ProfileStage::RASTER);
+    TRACE_SCOPE("raster");
+    threadPool.parallelFor(tileCount(), [&](size_t tileIndex) {
+        const std::vector<uint32_t>& bin = tileBins[tileIndex];
+        if (bin.empty()) {
+            return;
+        }
+        // One event per tile, i.e. per batch of triangles handed to triangle()
+        TRACE_SCOPE("tile");
+
+        Tile tile = tileBounds(tileIndex);
+        uint64_t writtenBlocks = 0;
+        uint64_t occluded = 0;
+        for (uint32_t i : bin) {
+            DepthTestResult coarseDepth = testTileDepth(tileIndex, tile,
+                                                        transformedVertices[triangles[3 * i]].position,
+                                                        transformedVertices[triangles[3 * i + 1]].position,
+                                                        transformedVertices[triangles[3 * i + 2]].position);
+            if (coarseDepth == DepthTestResult::OCCLUDED) {
+                occluded++;
+                continue;
+            }
+            // Blocks written during this call are nearer than their recorded bounds say
+            bool earlyZ = coarseDepth == DepthTestResult::PARTIAL || writtenBlocks != 0;
+
+            rasterize(tile, i, earlyZ, writtenBlocks);
+        }
+        threadCounters().tileTrianglesOccluded += occluded;
+
+        if (writtenBlocks) {
+            updateTileDepth(tileIndex, tile, writtenBlocks);
+        }
+    });
+}
+
+void render(const Mesh& mesh, const Uniforms& uniforms) {
+    TRACE_SCOPE("render");
+    if (deferredShading) {
+        // Only depth and triangle references now; resolveVisibilityBuffer() shades later
+        uint32_t draw = addDeferredDraw(uniforms.objectType);
+        std::vector<Vertex>& transformedVertices = deferredDraws[draw].vertices;
+        std::vector<uint32_t>& triangles = deferredDraws[draw].triangles;
+        transformVertices(mesh, uniforms, transformedVertices);
+
+        rasterizeTiles(mesh, uniforms, transformedVertices, triangles, [&](const Tile& tile, uint32_t i, bool, uint64_t& writtenBlocks) {
+            ProfileCounters& counters = threadCounters();
+            triangleVisibility(
+                    transformedVertices[triangles[3 * i]],
+                    transformedVertices[triangles[3 * i + 1]],
+                    transformedVertices[triangles[3 * i + 2]],
+                    tile.minX, tile.minY, tile.maxX, tile.maxY,
+                    [&](int x, int y, float z, float v, float u) {
+                        counters.fragmentsGenerated++;
+                        bool firstWrite = isBackgroundDepth(framebuffer.depth[framebuffer.index(x, y)]);
+                        if (writeVisibility(x, y, z, draw, i, v, u)) {
+                            counters.fragmentsWritten++;
+                            counters.pixelsCovered += firstWrite;
+                            writtenBlocks |= hizBlockBit(tile, x, y);
+                        }
+                    }
+            );
+        });
+        return;
+    }
+
+    // Kept across calls so the vertex and triangle storage is only allocated once
+    static std::vector<Vertex> transformedVertices;
+    static std::vector<uint32_t> triangles;
+    transformVertices(mesh, uniforms, transformedVertices);
+
+    rasterizeTiles(mesh, uniforms, transformedVertices, triangles, [&](const Tile& tile, uint32_t i, bool earlyZ, uint64_t& writtenBlocks) {
+        ProfileCounters& counters = threadCounters();
+        triangle(
+                transformedVertices[triangles[3 * i]],
+                transformedVertices[triangles[3 * i + 1]],
+                transformedVertices[triangles[3 * i + 2]],
+                tile.minX, tile.minY, tile.maxX, tile.maxY,
+                [&](Fragment& fragment) {
+                    counters.fragmentsGenerated++;
+                    // Early-Z: occluded fragments never reach the fragment shader
+                    if (earlyZ && !passesDepthTest(fragment)) {
+                        return;
+                    }
+                    profileShade(counters, [&] { shadeFragment(fragment, uniforms.objectType); });
+                    bool firstWrite = isBackgroundDepth(framebuffer.depth[framebuffer.index(fragment.x, fragment.y)]);
+                    if (point(fragment)) {
+                        counters.fragmentsWritten++;
+                        counters.pixelsCovered += firstWrite;
+                        writtenBlocks |= hizBlockBit(tile, fragment.x, fragment.y);
+                    }
+                }
+        );
+    });
+}
+
+glm::mat4 createViewportMatrix(size_t screenWidth, size_t screenHeight) {
+    glm::mat4 viewport = glm::mat4(1.0f);
+    viewport = glm::scale(viewport, glm::vec3(screenWidth / 2.0f, screenHeight / 2.0f, 0.5f));
+    viewport = glm::translate(viewport, glm::vec3(1.0f, 1.0f, 0.5f));
+
+    return viewport;
+}
+
+struct Planet {
+    ObjectType type;
+    float Radius;
+    float escala_F;
+    float Velocidad__;
+    float Angulo_P;
+};
+
+
+struct PlanetOrbit {
+    glm::vec2 lastPoint;
+    std::vector<glm::vec2> points;
+};
+
+
+void drawOrbit(const Planet& planet, const Uniforms& uniforms) {
+    const int numSegments = 100;
+
+    // Color de órbita
+    Fragment frag{};
+    frag.color = Color(1.0f, 1.0f, 1.0f);
+
+    glm::vec4 planetPosition = uniforms.projection * uniforms.view * glm::vec4(glm::vec3(uniforms.model[3]), 1.0f);
+    // Centro detras de la camara o muy fuera de la pantalla: las lineas serian
+    // enormes (o infinitas), asi que la orbita no se dibuja
+    if (planetPosition.w < NEAR_CLIP || std::abs(planetPosition.x) > GUARD_BAND * planetPosition.w ||
+        std::abs(planetPosition.y) > GUARD_BAND * planetPosition.w) {
+        return;
+    }
+    glm::vec2 screenPos = glm::vec2((planetPosition.x / planetPosition.w + 1.0f) * 0.5f * framebuffer.width,
+                                    (1.0f - planetPosition.y / planetPosition.w) * 0.5f * framebuffer.height);
+
+    static std::vector<glm::vec2> points;
+    
+    if (points.size() == 0) {
+        points.push_back(screenPos);
+    }
+
+    for (int i = 0; i <= numSegments; ++i) {
+        float theta = planet.Angulo_P - static_cast<float>(i) / numSegments * glm::two_pi<float>();
+        float x = screenPos.x + planet.Radius * cos(theta);
+        float y = screenPos.y - planet.Radius * sin(theta);
+
+        if (points.size() > 0) {
+            points.push_back(glm::vec2(x, y));
+        }
+    }
+
+    // Dibujar líneas entre puntos, excluyendo el primer punto
+    for (int i = 0; i < points.size() - 1; i++) {
+        glm::vec3 p1(points[i].x, points[i].y, 0);
+        glm::vec3 p2(points[i + 1].x, points[i + 1].y, 0);
+
+        // Dibujar fragments
+        line(p1, p2, [&](Fragment& f) {
+            // Asignar color blanco, detras de los planetas
+            f.color = frag.color;
+            f.z = ORBIT_DEPTH;
+            // La orbita puede salir de la pantalla al mover la camara
+            if (f.x < framebuffer.width && f.y < framebuffer.height) {
+                point(f);
+            }
+        });
+    }
+
+    if (points.size() > 1000) {
+        points.erase(points.begin(), points.begin() + points.size() - 1000);
+    }
+}
+
+std::vector<Planet> planets;
+int currentPlanet = 0;
+
+void setupPlanets() {
+    planets.clear();
+    planets.push_back({ ObjectType::SOL, 0.1f, 0.15f, 0.0f, 0.0f });
+    planets.push_back({ ObjectType::EARTH, 0.25f, 0.06f,0.07f, 0.0f });
+    planets.push_back({ ObjectType::SATURN, 0.35f, 0.06f,0.05f, 0.0f });
+    planets.push_back({ ObjectType::MARS, 0.45f, 0.08f,0.03f, 0.0f });
+    planets.push_back({ ObjectType::VENUS, 0.56f, 0.08f,0.01f, 0.0f });
+}
+
+Camera defaultCamera() {
+    Camera camera;
+    camera.cameraPosition = glm::vec3(0.0f, 0.0f, 1.5f);
+    camera.targetPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+    camera.upVector = glm::vec3(0.0f, 1.0f, 0.0f);
+    return camera;
+}
+
+// La proyeccion y el viewport dependen del tamaño del framebuffer
+void updateProjection(Uniforms& uniforms) {
+    float aspectRatio = static_cast<float>(framebuffer.width) / static_cast<float>(framebuffer.height);
+    uniforms.projection = glm::perspective(glm::radians(FOV_DEGREES), aspectRatio, NEAR_CLIP, FAR_CLIP);
+    uniforms.viewport = createViewportMatrix(framebuffer.width, framebuffer.height);
+}
+
+void drawStars() {
+    int numStars = rand() % 500;
+    for(int i = 0; i < numStars; i++) {
+
+        int x = rand() % framebuffer.width;
+        int y = rand() % framebuffer.height;
+
+        Fragment star{};
+        star.x = x;
+        star.y = y;
+        star.z = STAR_DEPTH;
+        star.color = Color(1.0f, 1.0f, 1.0f);
+
+        point(star);
+    }
+}
+
+// Dibuja un frame completo en el framebuffer y avanza las orbitas un paso fijo
+void renderFrame(const Mesh& mesh, Uniforms& uniforms, const Camera& camera) {
+    TRACE_SCOPE("frame");
+    frame += 1;
+    updateNoise(frame);
+
+    uniforms.view = glm::lookAt(
+            camera.cameraPosition,
+            camera.targetPosition,
+            glm::vec3(0.0f, 1.0f, 0.0f)
+    );
+    Frustum frustum = extractFrustum(uniforms.projection * uniforms.view);
+
+    clearFramebuffer();
+    clearTileDepths();
+    if (deferredShading) {
+        beginVisibilityFrame();
+    }
+    {
+        ProfileScope scope(ProfileStage::STARS);
+        TRACE_SCOPE("stars");
+        drawStars();
+    }
+
+    for (auto& planet : planets) {
+        uniforms.objectType = planet.type;
+        glm::vec3 systemOffset(-0.1f, 0.0f, 0.0f);
+        float Angulo_P = planet.Angulo_P;
+        float Radius = planet.Radius;
+        float orbitX = Radius * cos(Angulo_P);
+        float orbitY = Radius * sin(Angulo_P);
+        glm::mat4 translate = glm::translate(glm::mat4(1.0f), systemOffset);
+        glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(planet.Angulo_P), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 translation = glm::translate(glm::mat4(1.0f), glm::vec3(orbitX, 0.0f, orbitY));
+        glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(planet.escala_F));
+        glm::mat4 model = translate * rotation * translation * scale;
+
+        uniforms.model = model;
+
+        ProfileClock::time_point planetStart;
+        if (profilingEnabled) {
+            planetStart = ProfileClock::now();
+        }
+
+        {
+            ProfileScope scope(ProfileStage::ORBIT);
+            TRACE_SCOPE("orbit");
+            drawOrbit(planet, uniforms);
+        }
+
+        // Fuera de la camara: no pasa ni un vertice por el pipeline
+        if (meshInFrustum(frustum, model, mesh.boundsCenter, mesh.boundsRadius)) {
+            render(mesh, uniforms);
+        } else {
+            threadCounters().objectsCulled++;
+        }
+
+        if (profilingEnabled) {
+            profiler.addPlanet(planet.type, Profiler::milliseconds(planetStart, ProfileClock::now()));
+        }
+        planet.Angulo_P += planet.Velocidad__ * FIXED_DELTA_TIME;
+    }
+
+    if (deferredShading) {
+        ProfileScope scope(ProfileStage::RESOLVE);
+        TRACE_SCOPE("resolve");
+        resolveVisibilityBuffer(threadPool, [](Fragment& fragment, ObjectType objectType) {
+            profileShade(threadCounters(), [&] { shadeFragment(fragment, objectType); });
+        });
+    }
+}
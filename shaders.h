@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include "glm/geometric.hpp"
 #include "glm/glm.hpp"
 #include "FastNoise.h"
@@ -9,21 +10,55 @@
 
 static int frame = 0;
 
-Vertex vertexShader(const Vertex& vertex, const Uniforms& uniforms) {
-    // Apply transformations to the input vertex using the matrices from the uniforms
-    glm::vec4 clipSpaceVertex = uniforms.projection * uniforms.view * uniforms.model * glm::vec4(vertex.position, 1.0f);
+// Versions of the shaders whose output is baked into textures (bake.h). Bump
+// one whenever its shader, or the settings of its noise in setupNoise(),
+// change: cached textures are only baked again when their version differs.
+constexpr uint32_t EARTH_SHADER_VERSION = 1;
+constexpr uint32_t VENUS_SHADER_VERSION = 1;
+constexpr uint32_t MARS_SHADER_VERSION = 1;
+constexpr uint32_t SUN_SHADER_VERSION = 1;
+
+// Matrices of one draw, computed once instead of for every vertex
+struct VertexTransform {
+    glm::mat4 modelViewProjection;
+    glm::mat4 model;
+    glm::mat3 normalMatrix;  // inverse transpose of the model's 3x3 part
+    glm::mat4 viewport;
+};
+
+VertexTransform vertexTransform(const Uniforms& uniforms) {
+    return VertexTransform{
+            uniforms.projection * uniforms.view * uniforms.model,
+            uniforms.model,
+            glm::transpose(glm::inverse(glm::mat3(uniforms.model))),
+            uniforms.viewport
+    };
+}
+
+// Input of the vertex stage for vertex i of a mesh's arrays (texCoords may be
+// null). The other members are the vertex shader's outputs and start zeroed.
+Vertex vertexInput(const glm::vec3* positions, const glm::vec3* normals, const glm::vec3* texCoords, size_t i) {
+    Vertex vertex{};
+    vertex.position = positions[i];
+    vertex.normal = normals[i];
+    vertex.tex = texCoords ? texCoords[i] : glm::vec3(0.0f);
+    return vertex;
+}
+
+Vertex vertexShader(const Vertex& vertex, const VertexTransform& transform) {
+    // Apply transformations to the input vertex using the matrices of the draw
+    glm::vec4 clipSpaceVertex = transform.modelViewProjection * glm::vec4(vertex.position, 1.0f);
 
     // Perspective divide
     glm::vec3 ndcVertex = glm::vec3(clipSpaceVertex) / clipSpaceVertex.w;
 
     // Apply the viewport transform
-    glm::vec4 screenVertex = uniforms.viewport * glm::vec4(ndcVertex, 1.0f);
+    glm::vec4 screenVertex = transform.viewport * glm::vec4(ndcVertex, 1.0f);
 
-    // Transform the normal
-    glm::vec3 transformedNormal = glm::mat3(uniforms.model) * vertex.normal;
-    transformedNormal = glm::normalize(transformedNormal);
+    // Transform the normal; the inverse transpose keeps it perpendicular under non-uniform scale
+    glm::vec3 transformedNormal = glm::normalize(transform.normalMatrix * vertex.normal);
 
-    glm::vec3 transformedWorldPosition = glm::vec3(uniforms.model * glm::vec4(vertex.position, 1.0f));
+    glm::vec3 transformedWorldPosition = glm::vec3(transform.model * glm::vec4(vertex.position, 1.0f));
 
     // Return the transformed vertex as a vec3
     return Vertex{
@@ -31,7 +66,8 @@ Vertex vertexShader(const Vertex& vertex, const Uniforms& uniforms) {
             transformedNormal,
             vertex.tex,
             transformedWorldPosition,
-            vertex.position
+            vertex.position,
+            clipSpaceVertex
     };
 }
 
@@ -81,7 +117,7 @@ Fragment fragmentShaderStripes(Fragment& fragment) {
 
 
 
-Fragment fragmentShaderEarth(Fragment& fragment) {
+Fragment fragmentShaderEarth(Fragment& fragment, const FastNoiseLite& noiseGenerator) {
     Color color;
 
     glm::vec3 groundColor = glm::vec3(0, 0.5, 0);
@@ -112,8 +148,6 @@ Fragment fragmentShaderEarth(Fragment& fragment) {
     );
 
 
-    FastNoiseLite noiseGenerator;
-    noiseGenerator.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
     /* noiseGenerator.SetRotationType3D(FastNoiseLite::RotationType3D_ImproveXYPlanes); */
     /* noiseGenerator.DomainWarp(uv.x, uv.y, uv.z); */
 
@@ -156,7 +190,7 @@ Fragment fragmentShaderEarth(Fragment& fragment) {
 
 
 // Fragment Shader
-Fragment fragmentShaderVenus(Fragment& fragment) {
+Fragment fragmentShaderVenus(Fragment& fragment, const FastNoiseLite& noise) {
 
     Color color;
 
@@ -173,9 +207,6 @@ Fragment fragmentShaderVenus(Fragment& fragment) {
     Color planetColor(255, 230, 153); // Amarillo claro en la estructura Color
 
     // Ruido para variaciones de color (puedes ajustar los valores según tus preferencias)
-    FastNoiseLite noise;
-    noise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-
     float noiseX = 1234.0;
     float noiseY = 5678.0;
     float noiseScale = 5000.0; // Aumenta la escala del ruido para hacer las manchas más grandes
@@ -203,7 +234,7 @@ Fragment fragmentShaderVenus(Fragment& fragment) {
 }
 
 
-Fragment fragmentShaderMars(Fragment& fragment) {
+Fragment fragmentShaderMars(Fragment& fragment, const FastNoiseLite& noise) {
     Color color;
 
     // Coordenadas UV del fragmento
@@ -219,9 +250,6 @@ Fragment fragmentShaderMars(Fragment& fragment) {
     Color planetColor(210, 0, 0); // Rojo en la estructura Color
 
     // Ruido para variaciones de color (puedes ajustar los valores según tus preferencias)
-    FastNoiseLite noise;
-    noise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-
     float noiseX = 1234.0;
     float noiseY = 5678.0;
     float noiseScale = 5000.0; // Aumenta la escala del ruido para hacer los cráteres más grandes
@@ -251,7 +279,7 @@ Fragment fragmentShaderMars(Fragment& fragment) {
 
 
 
-Fragment fragmentShaderSaturn(Fragment fragment) {
+Fragment fragmentShaderSaturn(Fragment fragment, const FastNoiseLite& noise) {
 
     Color color;
 
@@ -268,25 +296,21 @@ Fragment fragmentShaderSaturn(Fragment fragment) {
     Color planetColor(201, 159, 79);
 
     // Primer ruido para nubes amarillas
-    FastNoiseLite noise1;
-    noise1.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
 
     float noiseX = 12345.0;
     float noiseY = 67890.0;
     float noiseScale1 = 50000.0;
 
-    float noiseValue1 = noise1.GetNoise((uv.x + noiseX) * noiseScale1,
+    float noiseValue1 = noise.GetNoise((uv.x + noiseX) * noiseScale1,
                                         (uv.y + noiseY) * noiseScale1);
 
     float cloudThreshold1 = 0.1;
 
-    // Segundo ruido para nubes moradas
-    FastNoiseLite noise2;
-    noise2.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+    // Segundo ruido para nubes moradas (mismo generador, otra escala)
 
     float noiseScale2 = 80000.0;
 
-    float noiseValue2 = noise2.GetNoise((uv.x + noiseX) * noiseScale2,
+    float noiseValue2 = noise.GetNoise((uv.x + noiseX) * noiseScale2,
                                         (uv.y + noiseY) * noiseScale2);
 
     float cloudThreshold2 = 0.08;
@@ -316,15 +340,12 @@ Fragment fragmentShaderSaturn(Fragment fragment) {
 
 
 
-Fragment fragmentShaderSun(Fragment& fragment) {
+Fragment fragmentShaderSun(Fragment& fragment, const FastNoiseLite& noiseGenerator) {
     Color color;
 
     // Get UV coordinates
     glm::vec2 uv = glm::vec2(fragment.originalPos.x, fragment.originalPos.y);
 
-    FastNoiseLite noiseGenerator;
-    noiseGenerator.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-
     float offsetX = 10000.0f;
     float offsetY = 10000.0f;
     float scale = 7000.0f; // Ajusta la escala para cambiar el patrón de cráteres
@@ -352,7 +373,7 @@ Fragment fragmentShaderSun(Fragment& fragment) {
 
 
 
-Fragment fragmentShader(Fragment& fragment) {
+Fragment fragmentShader(Fragment& fragment, const FastNoiseLite& noiseGenerator) {
     Color color;
 
     glm::vec3 brightColor = glm::vec3(1.0f, 0.6f, 0.0f);
@@ -369,10 +390,7 @@ Fragment fragmentShader(Fragment& fragment) {
             radius
     );
 
-    FastNoiseLite noiseGenerator;
-    noiseGenerator.SetNoiseType(FastNoiseLite::NoiseType_Cellular);
-    noiseGenerator.SetFrequency(0.02 + (10 - abs((static_cast<int>(frame/10.0f) % (2 * 10)) - 10))/2000.0f);
-
+    // La frecuencia del ruido cambia con el frame; updateNoise() la ajusta una vez por frame
     float zoom = 1000.0f;
 
     float lat = uv.y;  // Latitude
@@ -0,0 +1,68 @@
+#pragma once
+// Runtime selection of the SIMD kernels. The kernels are compiled for their
+// instruction set with per-function target attributes, so the rest of the
+// program keeps the baseline flags and still runs on CPUs without AVX2.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define SIMD_X86 0
+#endif
+
+#if SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define SIMD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#else
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_SSE41
+#endif
+
+enum class SimdLevel {
+    SCALAR,
+    SSE41,
+    AVX2
+};
+
+inline SimdLevel detectSimdLevel() {
+#if SIMD_X86 && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    // AVX registers are only usable when the OS saves the YMM state
+    if (maxLeaf >= 7 && osxsave && avx && fma && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    return avx2 ? SimdLevel::AVX2 : (sse41 ? SimdLevel::SSE41 : SimdLevel::SCALAR);
+#elif SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX2;
+    }
+    return __builtin_cpu_supports("sse4.1") ? SimdLevel::SSE41 : SimdLevel::SCALAR;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+// Highest level supported by this CPU. Can be lowered (never raised) to
+// compare the kernels against each other.
+inline SimdLevel simdLevel = detectSimdLevel();
+
+inline const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::SSE41: return "SSE4.1";
+        default: return "scalar";
+    }
+}
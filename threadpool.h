@@ -0,0 +1,119 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Persistent pool of worker threads. parallelFor() hands out indices through an
+// atomic counter, so uneven items (e.g. tiles with many triangles) balance out
+// across the workers. The calling thread takes part in the work too.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = std::max(1u, std::thread::hardware_concurrency())) {
+        for (size_t i = 1; i < threadCount; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads that run jobs, counting the caller of parallelFor().
+    size_t size() const {
+        return workers.size() + 1;
+    }
+
+    // Calls fn(i) for every i in [0, count) and returns once all calls finished.
+    template <typename Fn>
+    void parallelFor(size_t count, Fn&& fn) {
+        using Callable = std::remove_reference_t<Fn>;
+        run(count, [](void* context, size_t i) { (*static_cast<Callable*>(context))(i); }, &fn);
+    }
+
+private:
+    using Invoke = void (*)(void*, size_t);
+
+    void run(size_t count, Invoke invoke, void* context) {
+        if (count == 0) {
+            return;
+        }
+        if (workers.empty() || count == 1) {
+            for (size_t i = 0; i < count; ++i) {
+                invoke(context, i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobCount = count;
+            jobInvoke = invoke;
+            jobContext = context;
+            nextIndex.store(0, std::memory_order_relaxed);
+            pending = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+
+        work();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+    }
+
+    void work() {
+        size_t i;
+        while ((i = nextIndex.fetch_add(1, std::memory_order_relaxed)) < jobCount) {
+            jobInvoke(jobContext, i);
+        }
+    }
+
+    void workerLoop() {
+        size_t seenGeneration = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+            }
+
+            work();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool stopping = false;
+    size_t generation = 0;
+    size_t pending = 0;
+
+    size_t jobCount = 0;
+    Invoke jobInvoke = nullptr;
+    void* jobContext = nullptr;
+    std::atomic<size_t> nextIndex{0};
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "framebuffer.h"
+#include "fragment.h"
+
+// Screen-space tiles. Each tile is rasterized and shaded by a single worker, so
+// no two threads ever touch the same framebuffer pixel during render().
+constexpr int TILE_SIZE = 64;
+
+// The tile grid follows the framebuffer size
+size_t tilesX() {
+    return (framebuffer.width + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+size_t tilesY() {
+    return (framebuffer.height + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+size_t tileCount() {
+    return tilesX() * tilesY();
+}
+
+// Inclusive pixel bounds
+struct Tile {
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+};
+
+// Triangle indices per tile, reused across calls so the bins keep their capacity
+std::vector<std::vector<uint32_t>> tileBins;
+
+Tile tileBounds(size_t tileIndex) {
+    size_t columns = tilesX();
+    int tileX = static_cast<int>(tileIndex % columns) * TILE_SIZE;
+    int tileY = static_cast<int>(tileIndex / columns) * TILE_SIZE;
+    return Tile{
+        tileX,
+        tileY,
+        std::min(tileX + TILE_SIZE, static_cast<int>(framebuffer.width)) - 1,
+        std::min(tileY + TILE_SIZE, static_cast<int>(framebuffer.height)) - 1
+    };
+}
+
+// Sorts the triangles (three vertex indices each, from assembleTriangles())
+// into every tile their bounding box overlaps. Triangles keep their submission
+// order inside a bin. Returns how many triangles landed in at least one tile.
+size_t binTriangles(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& triangles) {
+    tileBins.resize(tileCount());
+    for (std::vector<uint32_t>& bin : tileBins) {
+        bin.clear();
+    }
+
+    size_t columns = tilesX();
+    float width = static_cast<float>(framebuffer.width);
+    float height = static_cast<float>(framebuffer.height);
+    size_t binned = 0;
+
+    for (size_t i = 0; i < triangles.size() / 3; ++i) {
+        const glm::vec3& A = vertices[triangles[3 * i]].position;
+        const glm::vec3& B = vertices[triangles[3 * i + 1]].position;
+        const glm::vec3& C = vertices[triangles[3 * i + 2]].position;
+
+        float minX = std::ceil(std::min(std::min(A.x, B.x), C.x));
+        float minY = std::ceil(std::min(std::min(A.y, B.y), C.y));
+        float maxX = std::floor(std::max(std::max(A.x, B.x), C.x));
+        float maxY = std::floor(std::max(std::max(A.y, B.y), C.y));
+
+        // Also rejects NaN bounds from vertices that could not be projected
+        if (!(minX <= maxX && minY <= maxY) || maxX < 0 || maxY < 0 || minX >= width || minY >= height)
+            continue;
+
+        binned++;
+        int firstTileX = static_cast<int>(std::max(minX, 0.0f)) / TILE_SIZE;
+        int firstTileY = static_cast<int>(std::max(minY, 0.0f)) / TILE_SIZE;
+        int lastTileX = static_cast<int>(std::min(maxX, width - 1)) / TILE_SIZE;
+        int lastTileY = static_cast<int>(std::min(maxY, height - 1)) / TILE_SIZE;
+
+        for (int tileY = firstTileY; tileY <= lastTileY; ++tileY) {
+            for (int tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+                tileBins[tileY * columns + tileX].push_back(static_cast<uint32_t>(i));
+            }
+        }
+    }
+    return binned;
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timeline tracing in the Chrome trace event format (chrome://tracing or
+// ui.perfetto.dev). TRACE_SCOPE("name") records when the scope starts and ends
+// on the calling thread. Each thread writes into its own ring buffer, so
+// recording takes no lock; when a ring is full the oldest events are dropped.
+// The name must be a string literal (only the pointer is stored).
+
+struct TraceEvent {
+    const char* name;
+    uint64_t beginNs;
+    uint64_t endNs;
+};
+
+constexpr size_t TRACE_RING_CAPACITY = size_t(1) << 16;
+
+// Single writer (its thread); read by Tracer::write() while the writer is idle
+struct TraceRing {
+    std::vector<TraceEvent> events = std::vector<TraceEvent>(TRACE_RING_CAPACITY);
+    std::atomic<uint64_t> head{0};  // events ever written
+    uint32_t threadId = 0;
+};
+
+using TraceClock = std::chrono::steady_clock;
+
+bool traceEnabled = false;
+
+class Tracer {
+public:
+    Tracer() : start(TraceClock::now()) {}
+
+    uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(TraceClock::now() - start).count();
+    }
+
+    TraceRing& threadRing() {
+        thread_local TraceRing* ring = nullptr;
+        if (!ring) {
+            std::lock_guard<std::mutex> lock(mutex);
+            rings.push_back(std::make_unique<TraceRing>());
+            ring = rings.back().get();
+            ring->threadId = static_cast<uint32_t>(rings.size());
+        }
+        return *ring;
+    }
+
+    void record(const char* name, uint64_t beginNs, uint64_t endNs) {
+        TraceRing& ring = threadRing();
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        ring.events[head % TRACE_RING_CAPACITY] = TraceEvent{name, beginNs, endNs};
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    // Writes the events still held by every ring as complete ("X") events.
+    // Call it between frames, when no worker is recording.
+    bool write(const std::string& path) {
+        FILE* file = std::fopen(path.c_str(), "w");
+        if (!file) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        bool first = true;
+        for (const std::unique_ptr<TraceRing>& ring : rings) {
+            // main() registers its ring before any worker runs, so it is thread 1
+            std::fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+                         first ? "" : ",\n", ring->threadId, ring->threadId == 1 ? "main" : "worker");
+            first = false;
+
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t begin = head > TRACE_RING_CAPACITY ? head - TRACE_RING_CAPACITY : 0;
+            for (uint64_t i = begin; i < head; ++i) {
+                const TraceEvent& event = ring->events[i % TRACE_RING_CAPACITY];
+                std::fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                             event.name, ring->threadId, event.beginNs / 1e3, (event.endNs - event.beginNs) / 1e3);
+            }
+        }
+        std::fprintf(file, "\n]}\n");
+        return std::fclose(file) == 0;
+    }
+
+    // Drops every recorded event, so the next write() starts from here. Same
+    // rule as write(): between frames.
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const std::unique_ptr<TraceRing>& ring : rings) {
+            ring->head.store(0, std::memory_order_release);
+        }
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceRing>> rings;
+    TraceClock::time_point start;
+};
+
+Tracer tracer;
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name(name), active(traceEnabled), beginNs(active ? tracer.now() : 0) {}
+
+    ~TraceScope() {
+        if (active) {
+            tracer.record(name, beginNs, tracer.now());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    bool active;
+    uint64_t beginNs;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
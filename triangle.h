@@ -1,84 +1,310 @@
 #pragma once
-#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <utility>
 #include "glm/glm.hpp"
 #include "line.h"
 #include "framebuffer.h"
 #include "color.h"
+#include "simd.h"
+#include "triangle_simd.h"
 
 glm::vec3 L = glm::vec3(0.0f, 0.0f, 1.0f);
 
-std::pair<float, float> barycentricCoordinates(const glm::ivec2& P, const glm::vec3& A, const glm::vec3& B, const glm::vec3& C) {
-    glm::vec3 bary = glm::cross(
-        glm::vec3(C.x - A.x, B.x - A.x, A.x - P.x),
-        glm::vec3(C.y - A.y, B.y - A.y, A.y - P.y)
-    );
+// Vertices are snapped to a 1/16 pixel grid before rasterization, so edges shared
+// by two triangles produce exactly the same edge function values on both sides.
+constexpr int SUBPIXEL_BITS = 4;
+constexpr int64_t SUBPIXEL_ONE = int64_t(1) << SUBPIXEL_BITS;
 
-    if (abs(bary.z) < 1) {
-        return std::make_pair(-1, -1);
-    }
+// Larger coordinates would overflow the 64-bit edge function products
+constexpr float MAX_SNAPPED_COORDINATE = 1 << 24;
+
+struct SnappedVertex {
+  int64_t x;
+  int64_t y;
+};
+
+bool isSnappable(const glm::vec3& p) {
+  return std::abs(p.x) < MAX_SNAPPED_COORDINATE && std::abs(p.y) < MAX_SNAPPED_COORDINATE;
+}
 
-    return std::make_pair(
-        bary.y / bary.z,
-        bary.x / bary.z
-    );    
+SnappedVertex snapVertex(const glm::vec3& p) {
+  return SnappedVertex{
+    std::llround(p.x * SUBPIXEL_ONE),
+    std::llround(p.y * SUBPIXEL_ONE)
+  };
 }
 
-std::vector<Fragment> triangle(const Vertex& a, const Vertex& b, const Vertex& c) {
-  std::vector<Fragment> fragments;
+// Twice the signed area of (v0, v1, p): positive when p is to the left of v0->v1
+int64_t edgeFunction(const SnappedVertex& v0, const SnappedVertex& v1, int64_t px, int64_t py) {
+  return (v1.x - v0.x) * (py - v0.y) - (v1.y - v0.y) * (px - v0.x);
+}
+
+// Top-left fill rule for counter-clockwise triangles: a pixel lying exactly on an
+// edge is only covered when that edge is a top or left edge, so a pixel on an edge
+// shared by two triangles is shaded once.
+bool isTopLeftEdge(const SnappedVertex& v0, const SnappedVertex& v1) {
+  int64_t dx = v1.x - v0.x;
+  int64_t dy = v1.y - v0.y;
+  return dy < 0 || (dy == 0 && dx < 0);
+}
+
+// Edge function stepped incrementally across the bounding box
+struct EdgeStepper {
+  int64_t row;    // value at the first pixel of the current row
+  int64_t stepX;  // change per pixel to the right
+  int64_t stepY;  // change per row up
+  int64_t bias;   // 0 on top-left edges, -1 elsewhere so only E > 0 passes
+
+  EdgeStepper() = default;
+  EdgeStepper(const SnappedVertex& v0, const SnappedVertex& v1, int64_t px, int64_t py)
+    : row(edgeFunction(v0, v1, px, py)),
+      stepX(-(v1.y - v0.y) * SUBPIXEL_ONE),
+      stepY((v1.x - v0.x) * SUBPIXEL_ONE),
+      bias(isTopLeftEdge(v0, v1) ? 0 : -1) {}
+};
+
+// True when the edge function stays within 32 bits over columns [0, lastColumn]
+// and rows [0, lastRow] of the bounding box, as the SIMD span kernels require.
+bool fitsSpanKernel(const EdgeStepper& edge, int64_t lastColumn, int64_t lastRow) {
+  constexpr int64_t limit = int64_t(1) << 30;
+  int64_t corners[4] = {
+    edge.row,
+    edge.row + edge.stepX * lastColumn,
+    edge.row + edge.stepY * lastRow,
+    edge.row + edge.stepX * lastColumn + edge.stepY * lastRow
+  };
+  for (int64_t value : corners) {
+    if (value <= -limit || value >= limit)
+      return false;
+  }
+  return std::abs(edge.stepX) * 8 < limit && std::abs(edge.stepY) < limit;
+}
+
+// Everything the rasterization loops need, computed once per triangle
+struct TriangleSetup {
+  int startX;
+  int startY;
+  int endX;
+  int endY;
+  // Edge i is the (unnormalized) barycentric weight of vertices[i]
+  EdgeStepper edges[3];
+  // a, b, c with b and c swapped when needed to make the order counter-clockwise
+  const Vertex* vertices[3];
+  bool swapped;
+  float invArea;
+};
+
+// Snaps the triangle, clips its bounding box to the inclusive pixel rectangle
+// [clipMinX, clipMaxX] x [clipMinY, clipMaxY] and sets up the edge functions.
+// Returns false when there is nothing to rasterize.
+bool setupTriangle(const Vertex& a, const Vertex& b, const Vertex& c,
+                   int clipMinX, int clipMinY, int clipMaxX, int clipMaxY,
+                   TriangleSetup& setup) {
   glm::vec3 A = a.position;
   glm::vec3 B = b.position;
   glm::vec3 C = c.position;
 
-  float minX = std::min(std::min(A.x, B.x), C.x);
-  float minY = std::min(std::min(A.y, B.y), C.y);
-  float maxX = std::max(std::max(A.x, B.x), C.x);
-  float maxY = std::max(std::max(A.y, B.y), C.y);
+  if (!isSnappable(A) || !isSnappable(B) || !isSnappable(C))
+    return false;
 
-  // Iterate over each point in the bounding box
-  for (int y = static_cast<int>(std::ceil(minY)); y <= static_cast<int>(std::floor(maxY)); ++y) {
-    for (int x = static_cast<int>(std::ceil(minX)); x <= static_cast<int>(std::floor(maxX)); ++x) {
-      if (x < 0 || y < 0 || y > SCREEN_HEIGHT || x > SCREEN_WIDTH)
-        continue;
-        
-      glm::ivec2 P(x, y);
-      auto barycentric = barycentricCoordinates(P, A, B, C);
-      float w = 1 - barycentric.first - barycentric.second;
-      float v = barycentric.first;
-      float u = barycentric.second;
-      float epsilon = 1e-10;
-
-      if (w < epsilon || v < epsilon || u < epsilon)
+  float minX = std::max(std::ceil(std::min(std::min(A.x, B.x), C.x)), static_cast<float>(clipMinX));
+  float minY = std::max(std::ceil(std::min(std::min(A.y, B.y), C.y)), static_cast<float>(clipMinY));
+  float maxX = std::min(std::floor(std::max(std::max(A.x, B.x), C.x)), static_cast<float>(clipMaxX));
+  float maxY = std::min(std::floor(std::max(std::max(A.y, B.y), C.y)), static_cast<float>(clipMaxY));
+
+  if (!(minX <= maxX && minY <= maxY))
+    return false;
+
+  SnappedVertex sa = snapVertex(A);
+  SnappedVertex sb = snapVertex(B);
+  SnappedVertex sc = snapVertex(C);
+
+  int64_t area = edgeFunction(sa, sb, sc.x, sc.y);
+  if (area == 0)
+    return false;
+
+  // Swap to counter-clockwise order so the interior is where every edge function is positive
+  setup.vertices[0] = &a;
+  setup.vertices[1] = &b;
+  setup.vertices[2] = &c;
+  setup.swapped = area < 0;
+  if (setup.swapped) {
+    std::swap(sb, sc);
+    std::swap(setup.vertices[1], setup.vertices[2]);
+    area = -area;
+  }
+
+  setup.startX = static_cast<int>(minX);
+  setup.startY = static_cast<int>(minY);
+  setup.endX = static_cast<int>(maxX);
+  setup.endY = static_cast<int>(maxY);
+  int64_t px = int64_t(setup.startX) * SUBPIXEL_ONE;
+  int64_t py = int64_t(setup.startY) * SUBPIXEL_ONE;
+
+  setup.edges[0] = EdgeStepper(sb, sc, px, py);
+  setup.edges[1] = EdgeStepper(sc, sa, px, py);
+  setup.edges[2] = EdgeStepper(sa, sb, px, py);
+  setup.invArea = 1.0f / static_cast<float>(area);
+  return true;
+}
+
+// Rasterizes the part of the triangle inside the inclusive pixel rectangle
+// [clipMinX, clipMaxX] x [clipMinY, clipMaxY] (a tile, or the whole screen) and
+// hands every covered, lit pixel straight to onFragment(Fragment&). Nothing is
+// buffered, so the caller shades and depth-tests while the fragment is hot.
+template <typename FragmentCallback>
+void triangle(const Vertex& a, const Vertex& b, const Vertex& c,
+              int clipMinX, int clipMinY, int clipMaxX, int clipMaxY,
+              FragmentCallback&& onFragment) {
+  TriangleSetup setup;
+  if (!setupTriangle(a, b, c, clipMinX, clipMinY, clipMaxX, clipMaxY, setup))
+    return;
+
+  const Vertex* vb = setup.vertices[1];
+  const Vertex* vc = setup.vertices[2];
+  EdgeStepper edgeA = setup.edges[0];
+  EdgeStepper edgeB = setup.edges[1];
+  EdgeStepper edgeC = setup.edges[2];
+  int startX = setup.startX;
+  int startY = setup.startY;
+  int endX = setup.endX;
+  int endY = setup.endY;
+  float invArea = setup.invArea;
+
+  auto emit = [&](int x, int y, float z, float intensity, const glm::vec3& worldPos, const glm::vec3& originalPos) {
+    Fragment fragment{
+      static_cast<uint16_t>(x),
+      static_cast<uint16_t>(y),
+      z,
+      Color(255, 255, 255),
+      intensity,
+      worldPos,
+      originalPos
+    };
+    onFragment(fragment);
+  };
+
+#if SIMD_X86
+  // The span kernels evaluate up to 7 pixels past the end of a row
+  int64_t lastColumn = endX - startX + 7;
+  int64_t lastRow = endY - startY;
+  if (simdLevel != SimdLevel::SCALAR &&
+      fitsSpanKernel(edgeA, lastColumn, lastRow) &&
+      fitsSpanKernel(edgeB, lastColumn, lastRow) &&
+      fitsSpanKernel(edgeC, lastColumn, lastRow)) {
+    SpanTriangle span;
+    span.startX = startX;
+    span.startY = startY;
+    span.endX = endX;
+    span.endY = endY;
+    span.invArea = invArea;
+    span.light = L;
+    for (int i = 0; i < 3; ++i) {
+      span.edgeRow[i] = static_cast<int32_t>(setup.edges[i].row);
+      span.edgeStepX[i] = static_cast<int32_t>(setup.edges[i].stepX);
+      span.edgeStepY[i] = static_cast<int32_t>(setup.edges[i].stepY);
+      span.edgeBias[i] = static_cast<int32_t>(setup.edges[i].bias);
+      span.z[i] = setup.vertices[i]->position.z;
+      span.normal[i] = setup.vertices[i]->normal;
+      span.worldPos[i] = setup.vertices[i]->worldPos;
+      span.originalPos[i] = setup.vertices[i]->originalPos;
+    }
+
+    if (simdLevel == SimdLevel::AVX2) {
+      rasterizeSpansAVX2(span, emit);
+    } else {
+      rasterizeSpansSSE41(span, emit);
+    }
+    return;
+  }
+#endif
+
+  for (int y = startY; y <= endY; ++y) {
+    int64_t eA = edgeA.row;
+    int64_t eB = edgeB.row;
+    int64_t eC = edgeC.row;
+
+    for (int x = startX; x <= endX; ++x, eA += edgeA.stepX, eB += edgeB.stepX, eC += edgeC.stepX) {
+      // All three biased values are non-negative exactly when the sign bit of their OR is clear
+      if (((eA + edgeA.bias) | (eB + edgeB.bias) | (eC + edgeC.bias)) < 0)
         continue;
-          
-      double z = A.z * w + B.z * v + C.z * u;
-      
-       glm::vec3 normal = glm::normalize( 
-           a.normal * w + b.normal * v + c.normal * u
-       ); 
+
+      float w = static_cast<float>(eA) * invArea;
+      float v = static_cast<float>(eB) * invArea;
+      float u = static_cast<float>(eC) * invArea;
+
+      float z = a.position.z * w + vb->position.z * v + vc->position.z * u;
+
+      glm::vec3 normal = glm::normalize(
+          a.normal * w + vb->normal * v + vc->normal * u
+      );
 
       // glm::vec3 normal = a.normal; // assume flatness
       float intensity = glm::dot(normal, L);
-      
+
       if (intensity < 0)
         continue;
 
-      Color color = Color(255, 255, 255);
-
-      glm::vec3 worldPos = a.worldPos * w + b.worldPos * v + c.worldPos * u;
-      glm::vec3 originalPos = a.originalPos * w + b.originalPos * v + c.originalPos * u;
-
-      fragments.push_back(
-        Fragment{
-          static_cast<uint16_t>(P.x),
-          static_cast<uint16_t>(P.y),
-          z,
-          color,
-          intensity,
-          worldPos,
-          originalPos
-        }
-      );
+      glm::vec3 worldPos = a.worldPos * w + vb->worldPos * v + vc->worldPos * u;
+      glm::vec3 originalPos = a.originalPos * w + vb->originalPos * v + vc->originalPos * u;
+
+      emit(x, y, z, intensity, worldPos, originalPos);
     }
+
+    edgeA.row += edgeA.stepY;
+    edgeB.row += edgeB.stepY;
+    edgeC.row += edgeC.stepY;
+  }
 }
-  return fragments;
+
+// Depth-only variant for the visibility pass: no attributes are interpolated.
+// onSample(x, y, z, v, u) gets the depth and the barycentric weights of b and c
+// (in the caller's vertex order) for every covered pixel that triangle() would
+// emit, i.e. the interpolated normal must face the light.
+template <typename SampleCallback>
+void triangleVisibility(const Vertex& a, const Vertex& b, const Vertex& c,
+                        int clipMinX, int clipMinY, int clipMaxX, int clipMaxY,
+                        SampleCallback&& onSample) {
+  TriangleSetup setup;
+  if (!setupTriangle(a, b, c, clipMinX, clipMinY, clipMaxX, clipMaxY, setup))
+    return;
+
+  // Only the sign of dot(normal, L) matters, and normalizing does not change it
+  float lightDot[3];
+  float depth[3];
+  for (int i = 0; i < 3; ++i) {
+    lightDot[i] = glm::dot(setup.vertices[i]->normal, L);
+    depth[i] = setup.vertices[i]->position.z;
+  }
+
+  EdgeStepper edges[3] = { setup.edges[0], setup.edges[1], setup.edges[2] };
+  for (int y = setup.startY; y <= setup.endY; ++y) {
+    int64_t e0 = edges[0].row;
+    int64_t e1 = edges[1].row;
+    int64_t e2 = edges[2].row;
+
+    for (int x = setup.startX; x <= setup.endX; ++x, e0 += edges[0].stepX, e1 += edges[1].stepX, e2 += edges[2].stepX) {
+      if (((e0 + edges[0].bias) | (e1 + edges[1].bias) | (e2 + edges[2].bias)) < 0)
+        continue;
+
+      float w0 = static_cast<float>(e0) * setup.invArea;
+      float w1 = static_cast<float>(e1) * setup.invArea;
+      float w2 = static_cast<float>(e2) * setup.invArea;
+
+      if (lightDot[0] * w0 + lightDot[1] * w1 + lightDot[2] * w2 < 0)
+        continue;
+
+      float z = depth[0] * w0 + depth[1] * w1 + depth[2] * w2;
+      if (setup.swapped) {
+        onSample(x, y, z, w2, w1);
+      } else {
+        onSample(x, y, z, w1, w2);
+      }
+    }
+
+    edges[0].row += edges[0].stepY;
+    edges[1].row += edges[1].stepY;
+    edges[2].row += edges[2].stepY;
+  }
 }
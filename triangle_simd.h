@@ -0,0 +1,211 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include "glm/glm.hpp"
+#include "simd.h"
+
+// Per-triangle constants for the SIMD span kernels. The edge functions are the
+// same fixed-point values triangle() steps in scalar code, narrowed to 32 bits
+// (triangle() only takes this path when they fit), so coverage is identical.
+// Vertex 0 is weighted by edge 0, and so on.
+struct SpanTriangle {
+    int startX;
+    int startY;
+    int endX;
+    int endY;
+    int32_t edgeRow[3];
+    int32_t edgeStepX[3];
+    int32_t edgeStepY[3];
+    int32_t edgeBias[3];
+    float invArea;
+    float z[3];
+    glm::vec3 normal[3];
+    glm::vec3 worldPos[3];
+    glm::vec3 originalPos[3];
+    glm::vec3 light;
+};
+
+// emit(x, y, z, intensity, worldPos, originalPos) is called for every covered,
+// lit pixel in the same order as the scalar loop.
+
+#if SIMD_X86
+
+// w * a + v * b + u * c for eight pixels
+SIMD_TARGET_AVX2 inline __m256 interpolateAVX2(__m256 w, __m256 v, __m256 u, float a, float b, float c) {
+    return _mm256_fmadd_ps(u, _mm256_set1_ps(c), _mm256_fmadd_ps(v, _mm256_set1_ps(b), _mm256_mul_ps(w, _mm256_set1_ps(a))));
+}
+
+// 8x1 spans: coverage, depth and every attribute for eight pixels per iteration.
+template <typename Emit>
+SIMD_TARGET_AVX2 void rasterizeSpansAVX2(const SpanTriangle& t, Emit&& emit) {
+    const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i laneOffset[3], spanStep[3], bias[3];
+    for (int e = 0; e < 3; ++e) {
+        laneOffset[e] = _mm256_mullo_epi32(laneIndex, _mm256_set1_epi32(t.edgeStepX[e]));
+        spanStep[e] = _mm256_set1_epi32(t.edgeStepX[e] * 8);
+        bias[e] = _mm256_set1_epi32(t.edgeBias[e]);
+    }
+    const __m256 invArea = _mm256_set1_ps(t.invArea);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 threeHalves = _mm256_set1_ps(1.5f);
+
+    alignas(32) float z[8], intensity[8];
+    alignas(32) float worldX[8], worldY[8], worldZ[8];
+    alignas(32) float originalX[8], originalY[8], originalZ[8];
+
+    int32_t row[3] = { t.edgeRow[0], t.edgeRow[1], t.edgeRow[2] };
+    for (int y = t.startY; y <= t.endY; ++y) {
+        __m256i e0 = _mm256_add_epi32(_mm256_set1_epi32(row[0]), laneOffset[0]);
+        __m256i e1 = _mm256_add_epi32(_mm256_set1_epi32(row[1]), laneOffset[1]);
+        __m256i e2 = _mm256_add_epi32(_mm256_set1_epi32(row[2]), laneOffset[2]);
+
+        for (int x = t.startX; x <= t.endX; x += 8) {
+            __m256i inside = _mm256_or_si256(
+                _mm256_or_si256(_mm256_add_epi32(e0, bias[0]), _mm256_add_epi32(e1, bias[1])),
+                _mm256_add_epi32(e2, bias[2]));
+            int mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(inside)) & 0xFF;
+            if (t.endX - x < 7) {
+                mask &= (1 << (t.endX - x + 1)) - 1;
+            }
+
+            if (mask) {
+                __m256 w = _mm256_mul_ps(_mm256_cvtepi32_ps(e0), invArea);
+                __m256 v = _mm256_mul_ps(_mm256_cvtepi32_ps(e1), invArea);
+                __m256 u = _mm256_mul_ps(_mm256_cvtepi32_ps(e2), invArea);
+
+                __m256 nx = interpolateAVX2(w, v, u, t.normal[0].x, t.normal[1].x, t.normal[2].x);
+                __m256 ny = interpolateAVX2(w, v, u, t.normal[0].y, t.normal[1].y, t.normal[2].y);
+                __m256 nz = interpolateAVX2(w, v, u, t.normal[0].z, t.normal[1].z, t.normal[2].z);
+
+                // Reciprocal square root refined with one Newton-Raphson step
+                __m256 lengthSq = _mm256_fmadd_ps(nz, nz, _mm256_fmadd_ps(ny, ny, _mm256_mul_ps(nx, nx)));
+                __m256 invLength = _mm256_rsqrt_ps(lengthSq);
+                invLength = _mm256_mul_ps(invLength, _mm256_fnmadd_ps(_mm256_mul_ps(half, lengthSq),
+                                                                      _mm256_mul_ps(invLength, invLength), threeHalves));
+
+                __m256 lit = _mm256_fmadd_ps(nz, _mm256_set1_ps(t.light.z),
+                             _mm256_fmadd_ps(ny, _mm256_set1_ps(t.light.y), _mm256_mul_ps(nx, _mm256_set1_ps(t.light.x))));
+                lit = _mm256_mul_ps(lit, invLength);
+                mask &= ~_mm256_movemask_ps(_mm256_cmp_ps(lit, zero, _CMP_LT_OQ));
+
+                if (mask) {
+                    _mm256_store_ps(intensity, lit);
+                    _mm256_store_ps(z, interpolateAVX2(w, v, u, t.z[0], t.z[1], t.z[2]));
+                    _mm256_store_ps(worldX, interpolateAVX2(w, v, u, t.worldPos[0].x, t.worldPos[1].x, t.worldPos[2].x));
+                    _mm256_store_ps(worldY, interpolateAVX2(w, v, u, t.worldPos[0].y, t.worldPos[1].y, t.worldPos[2].y));
+                    _mm256_store_ps(worldZ, interpolateAVX2(w, v, u, t.worldPos[0].z, t.worldPos[1].z, t.worldPos[2].z));
+                    _mm256_store_ps(originalX, interpolateAVX2(w, v, u, t.originalPos[0].x, t.originalPos[1].x, t.originalPos[2].x));
+                    _mm256_store_ps(originalY, interpolateAVX2(w, v, u, t.originalPos[0].y, t.originalPos[1].y, t.originalPos[2].y));
+                    _mm256_store_ps(originalZ, interpolateAVX2(w, v, u, t.originalPos[0].z, t.originalPos[1].z, t.originalPos[2].z));
+
+                    while (mask) {
+                        int lane = std::countr_zero(static_cast<unsigned>(mask));
+                        mask &= mask - 1;
+                        emit(x + lane, y, z[lane], intensity[lane],
+                             glm::vec3(worldX[lane], worldY[lane], worldZ[lane]),
+                             glm::vec3(originalX[lane], originalY[lane], originalZ[lane]));
+                    }
+                }
+            }
+
+            e0 = _mm256_add_epi32(e0, spanStep[0]);
+            e1 = _mm256_add_epi32(e1, spanStep[1]);
+            e2 = _mm256_add_epi32(e2, spanStep[2]);
+        }
+
+        row[0] += t.edgeStepY[0];
+        row[1] += t.edgeStepY[1];
+        row[2] += t.edgeStepY[2];
+    }
+}
+
+SIMD_TARGET_SSE41 inline __m128 interpolateSSE41(__m128 w, __m128 v, __m128 u, float a, float b, float c) {
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(w, _mm_set1_ps(a)), _mm_mul_ps(v, _mm_set1_ps(b))), _mm_mul_ps(u, _mm_set1_ps(c)));
+}
+
+// Fallback for CPUs without AVX2: the same kernel on 4x1 spans.
+template <typename Emit>
+SIMD_TARGET_SSE41 void rasterizeSpansSSE41(const SpanTriangle& t, Emit&& emit) {
+    const __m128i laneIndex = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i laneOffset[3], spanStep[3], bias[3];
+    for (int e = 0; e < 3; ++e) {
+        laneOffset[e] = _mm_mullo_epi32(laneIndex, _mm_set1_epi32(t.edgeStepX[e]));
+        spanStep[e] = _mm_set1_epi32(t.edgeStepX[e] * 4);
+        bias[e] = _mm_set1_epi32(t.edgeBias[e]);
+    }
+    const __m128 invArea = _mm_set1_ps(t.invArea);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 threeHalves = _mm_set1_ps(1.5f);
+
+    alignas(16) float z[4], intensity[4];
+    alignas(16) float worldX[4], worldY[4], worldZ[4];
+    alignas(16) float originalX[4], originalY[4], originalZ[4];
+
+    int32_t row[3] = { t.edgeRow[0], t.edgeRow[1], t.edgeRow[2] };
+    for (int y = t.startY; y <= t.endY; ++y) {
+        __m128i e0 = _mm_add_epi32(_mm_set1_epi32(row[0]), laneOffset[0]);
+        __m128i e1 = _mm_add_epi32(_mm_set1_epi32(row[1]), laneOffset[1]);
+        __m128i e2 = _mm_add_epi32(_mm_set1_epi32(row[2]), laneOffset[2]);
+
+        for (int x = t.startX; x <= t.endX; x += 4) {
+            __m128i inside = _mm_or_si128(
+                _mm_or_si128(_mm_add_epi32(e0, bias[0]), _mm_add_epi32(e1, bias[1])),
+                _mm_add_epi32(e2, bias[2]));
+            int mask = ~_mm_movemask_ps(_mm_castsi128_ps(inside)) & 0xF;
+            if (t.endX - x < 3) {
+                mask &= (1 << (t.endX - x + 1)) - 1;
+            }
+
+            if (mask) {
+                __m128 w = _mm_mul_ps(_mm_cvtepi32_ps(e0), invArea);
+                __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(e1), invArea);
+                __m128 u = _mm_mul_ps(_mm_cvtepi32_ps(e2), invArea);
+
+                __m128 nx = interpolateSSE41(w, v, u, t.normal[0].x, t.normal[1].x, t.normal[2].x);
+                __m128 ny = interpolateSSE41(w, v, u, t.normal[0].y, t.normal[1].y, t.normal[2].y);
+                __m128 nz = interpolateSSE41(w, v, u, t.normal[0].z, t.normal[1].z, t.normal[2].z);
+
+                __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+                __m128 invLength = _mm_rsqrt_ps(lengthSq);
+                invLength = _mm_mul_ps(invLength, _mm_sub_ps(threeHalves,
+                                                             _mm_mul_ps(_mm_mul_ps(half, lengthSq), _mm_mul_ps(invLength, invLength))));
+
+                __m128 lit = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_set1_ps(t.light.x)), _mm_mul_ps(ny, _mm_set1_ps(t.light.y))),
+                                        _mm_mul_ps(nz, _mm_set1_ps(t.light.z)));
+                lit = _mm_mul_ps(lit, invLength);
+                mask &= ~_mm_movemask_ps(_mm_cmplt_ps(lit, zero));
+
+                if (mask) {
+                    _mm_store_ps(intensity, lit);
+                    _mm_store_ps(z, interpolateSSE41(w, v, u, t.z[0], t.z[1], t.z[2]));
+                    _mm_store_ps(worldX, interpolateSSE41(w, v, u, t.worldPos[0].x, t.worldPos[1].x, t.worldPos[2].x));
+                    _mm_store_ps(worldY, interpolateSSE41(w, v, u, t.worldPos[0].y, t.worldPos[1].y, t.worldPos[2].y));
+                    _mm_store_ps(worldZ, interpolateSSE41(w, v, u, t.worldPos[0].z, t.worldPos[1].z, t.worldPos[2].z));
+                    _mm_store_ps(originalX, interpolateSSE41(w, v, u, t.originalPos[0].x, t.originalPos[1].x, t.originalPos[2].x));
+                    _mm_store_ps(originalY, interpolateSSE41(w, v, u, t.originalPos[0].y, t.originalPos[1].y, t.originalPos[2].y));
+                    _mm_store_ps(originalZ, interpolateSSE41(w, v, u, t.originalPos[0].z, t.originalPos[1].z, t.originalPos[2].z));
+
+                    while (mask) {
+                        int lane = std::countr_zero(static_cast<unsigned>(mask));
+                        mask &= mask - 1;
+                        emit(x + lane, y, z[lane], intensity[lane],
+                             glm::vec3(worldX[lane], worldY[lane], worldZ[lane]),
+                             glm::vec3(originalX[lane], originalY[lane], originalZ[lane]));
+                    }
+                }
+            }
+
+            e0 = _mm_add_epi32(e0, spanStep[0]);
+            e1 = _mm_add_epi32(e1, spanStep[1]);
+            e2 = _mm_add_epi32(e2, spanStep[2]);
+        }
+
+        row[0] += t.edgeStepY[0];
+        row[1] += t.edgeStepY[1];
+        row[2] += t.edgeStepY[2];
+    }
+}
+
+#endif
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstddef>
+#include "glm/glm.hpp"
+#include "fragment.h"
+#include "shaders.h"
+#include "simd.h"
+
+// Batch vertex stage: vertexShader() for eight vertices per iteration. The
+// mesh keeps positions and normals in their own arrays; each group of eight
+// xyz triples is split into x, y and z registers, transformed, and written
+// back as Vertex for the rasterizer. Vertices past the last full group go
+// through the scalar vertexShader().
+
+#if SIMD_X86
+
+// Eight consecutive vec3 (three loads) into one register per component
+SIMD_TARGET_AVX2 inline void loadVec3AVX2(const glm::vec3* p, __m256& x, __m256& y, __m256& z) {
+    const float* f = &p[0].x;
+    __m256 m0 = _mm256_loadu_ps(f);       // x0 y0 z0 x1 y1 z1 x2 y2
+    __m256 m1 = _mm256_loadu_ps(f + 8);   // z2 x3 y3 z3 x4 y4 z4 x5
+    __m256 m2 = _mm256_loadu_ps(f + 16);  // y5 z5 x6 y6 z6 x7 y7 z7
+    __m256 xs = _mm256_blend_ps(_mm256_blend_ps(m0, m1, 0x92), m2, 0x24);
+    __m256 ys = _mm256_blend_ps(_mm256_blend_ps(m0, m1, 0x24), m2, 0x49);
+    __m256 zs = _mm256_blend_ps(_mm256_blend_ps(m0, m1, 0x49), m2, 0x92);
+    x = _mm256_permutevar8x32_ps(xs, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+    y = _mm256_permutevar8x32_ps(ys, _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6));
+    z = _mm256_permutevar8x32_ps(zs, _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+}
+
+// Row r of m * (x, y, z, w) for a glm (column-major) matrix
+SIMD_TARGET_AVX2 inline __m256 transformRowAVX2(const glm::mat4& m, int r, __m256 x, __m256 y, __m256 z, __m256 w) {
+    __m256 sum = _mm256_mul_ps(w, _mm256_set1_ps(m[3][r]));
+    sum = _mm256_fmadd_ps(z, _mm256_set1_ps(m[2][r]), sum);
+    sum = _mm256_fmadd_ps(y, _mm256_set1_ps(m[1][r]), sum);
+    return _mm256_fmadd_ps(x, _mm256_set1_ps(m[0][r]), sum);
+}
+
+// Same, for the point (x, y, z, 1)
+SIMD_TARGET_AVX2 inline __m256 transformPointRowAVX2(const glm::mat4& m, int r, __m256 x, __m256 y, __m256 z) {
+    __m256 sum = _mm256_fmadd_ps(z, _mm256_set1_ps(m[2][r]), _mm256_set1_ps(m[3][r]));
+    sum = _mm256_fmadd_ps(y, _mm256_set1_ps(m[1][r]), sum);
+    return _mm256_fmadd_ps(x, _mm256_set1_ps(m[0][r]), sum);
+}
+
+// Transforms vertices [begin, end) of the arrays into out[begin, end)
+SIMD_TARGET_AVX2 void transformVerticesAVX2(const glm::vec3* positions, const glm::vec3* normals,
+                                            const glm::vec3* texCoords, size_t begin, size_t end,
+                                            const VertexTransform& transform, Vertex* out) {
+    const glm::mat4& mvp = transform.modelViewProjection;
+    const glm::mat4& model = transform.model;
+    const glm::mat4& viewport = transform.viewport;
+    const glm::mat3& normalMatrix = transform.normalMatrix;
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    alignas(32) float clip[4][8], screen[3][8], normal[3][8], world[3][8];
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 px, py, pz;
+        loadVec3AVX2(positions + i, px, py, pz);
+
+        // Clip space, perspective divide, viewport
+        __m256 clipX = transformPointRowAVX2(mvp, 0, px, py, pz);
+        __m256 clipY = transformPointRowAVX2(mvp, 1, px, py, pz);
+        __m256 clipZ = transformPointRowAVX2(mvp, 2, px, py, pz);
+        __m256 clipW = transformPointRowAVX2(mvp, 3, px, py, pz);
+        _mm256_store_ps(clip[0], clipX);
+        _mm256_store_ps(clip[1], clipY);
+        _mm256_store_ps(clip[2], clipZ);
+        _mm256_store_ps(clip[3], clipW);
+        __m256 invW = _mm256_div_ps(one, clipW);
+        __m256 ndcX = _mm256_mul_ps(clipX, invW);
+        __m256 ndcY = _mm256_mul_ps(clipY, invW);
+        __m256 ndcZ = _mm256_mul_ps(clipZ, invW);
+        for (int r = 0; r < 3; ++r) {
+            _mm256_store_ps(screen[r], transformRowAVX2(viewport, r, ndcX, ndcY, ndcZ, one));
+            _mm256_store_ps(world[r], transformPointRowAVX2(model, r, px, py, pz));
+        }
+
+        __m256 nx, ny, nz;
+        loadVec3AVX2(normals + i, nx, ny, nz);
+        __m256 tn[3];
+        for (int r = 0; r < 3; ++r) {
+            __m256 sum = _mm256_mul_ps(nz, _mm256_set1_ps(normalMatrix[2][r]));
+            sum = _mm256_fmadd_ps(ny, _mm256_set1_ps(normalMatrix[1][r]), sum);
+            tn[r] = _mm256_fmadd_ps(nx, _mm256_set1_ps(normalMatrix[0][r]), sum);
+        }
+        __m256 lengthSquared = _mm256_fmadd_ps(tn[2], tn[2], _mm256_fmadd_ps(tn[1], tn[1], _mm256_mul_ps(tn[0], tn[0])));
+        __m256 invLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSquared));
+        for (int r = 0; r < 3; ++r) {
+            _mm256_store_ps(normal[r], _mm256_mul_ps(tn[r], invLength));
+        }
+
+        for (int k = 0; k < 8; ++k) {
+            Vertex& vertex = out[i + k];
+            vertex.position = glm::vec3(screen[0][k], screen[1][k], screen[2][k]);
+            vertex.normal = glm::vec3(normal[0][k], normal[1][k], normal[2][k]);
+            vertex.tex = texCoords ? texCoords[i + k] : glm::vec3(0.0f);
+            vertex.worldPos = glm::vec3(world[0][k], world[1][k], world[2][k]);
+            vertex.originalPos = positions[i + k];
+            vertex.clipPos = glm::vec4(clip[0][k], clip[1][k], clip[2][k], clip[3][k]);
+        }
+    }
+
+    for (; i < end; ++i) {
+        out[i] = vertexShader(vertexInput(positions, normals, texCoords, i), transform);
+    }
+}
+
+#endif
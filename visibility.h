@@ -0,0 +1,114 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "glm/glm.hpp"
+#include "color.h"
+#include "fragment.h"
+#include "framebuffer.h"
+#include "threadpool.h"
+#include "trace.h"
+#include "triangle.h"
+#include "uniforms.h"
+
+// Deferred (visibility buffer) shading. The first pass only rasterizes depth
+// and records which triangle won each pixel and where; the second pass runs
+// the fragment shader once per visible pixel, so the shading cost no longer
+// grows with overdraw.
+
+constexpr uint32_t NO_DRAW = std::numeric_limits<uint32_t>::max();
+
+struct VisibilitySample {
+    uint32_t draw;       // index into deferredDraws, NO_DRAW when empty
+    uint32_t primitive;  // triangle index inside that draw
+    float v;             // barycentric weight of the triangle's second vertex
+    float u;             // barycentric weight of the third vertex
+    float z;             // depth written by the visibility pass
+};
+
+// One render() call. Its screen-space vertices and assembled triangles (three
+// vertex indices each) must live until the resolve.
+struct DeferredDraw {
+    ObjectType objectType;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> triangles;
+};
+
+bool deferredShading = false;
+
+std::vector<VisibilitySample> visibilityBuffer;
+
+// Reused across frames so the vertex and triangle storage of each draw keeps its capacity
+std::vector<DeferredDraw> deferredDraws;
+size_t deferredDrawCount = 0;
+
+void beginVisibilityFrame() {
+    visibilityBuffer.resize(framebuffer.width * framebuffer.height);
+    std::fill(visibilityBuffer.begin(), visibilityBuffer.end(), VisibilitySample{NO_DRAW, 0, 0.0f, 0.0f, 0.0f});
+    deferredDrawCount = 0;
+}
+
+uint32_t addDeferredDraw(ObjectType objectType) {
+    if (deferredDrawCount == deferredDraws.size()) {
+        deferredDraws.emplace_back();
+    }
+    deferredDraws[deferredDrawCount].objectType = objectType;
+    return static_cast<uint32_t>(deferredDrawCount++);
+}
+
+// Depth-tests a sample and, when it is nearest so far, stores its depth and
+// triangle reference. Returns true if it was written.
+bool writeVisibility(int x, int y, float z, uint32_t draw, uint32_t primitive, float v, float u) {
+    size_t index = framebuffer.index(x, y);
+    if (!(z < framebuffer.depth[index])) {
+        return false;
+    }
+    framebuffer.depth[index] = z;
+    visibilityBuffer[index] = VisibilitySample{draw, primitive, v, u, z};
+    return true;
+}
+
+// Shades every pixel the visibility pass kept with shade(Fragment&, ObjectType)
+// and stores the color. Rows are independent, so they are spread over the pool.
+template <typename Shade>
+void resolveVisibilityBuffer(ThreadPool& pool, Shade&& shade) {
+    pool.parallelFor(framebuffer.height, [&](size_t y) {
+        TRACE_SCOPE("shade row");
+        for (size_t x = 0; x < framebuffer.width; ++x) {
+            size_t index = y * framebuffer.width + x;
+            const VisibilitySample& sample = visibilityBuffer[index];
+            if (sample.draw == NO_DRAW) {
+                continue;
+            }
+
+            // Something drawn with point() afterwards (an orbit) covers the pixel
+            if (framebuffer.depth[index] != sample.z) {
+                continue;
+            }
+
+            const DeferredDraw& draw = deferredDraws[sample.draw];
+            const Vertex& a = draw.vertices[draw.triangles[3 * sample.primitive]];
+            const Vertex& b = draw.vertices[draw.triangles[3 * sample.primitive + 1]];
+            const Vertex& c = draw.vertices[draw.triangles[3 * sample.primitive + 2]];
+            float v = sample.v;
+            float u = sample.u;
+            float w = 1.0f - v - u;
+
+            glm::vec3 normal = glm::normalize(a.normal * w + b.normal * v + c.normal * u);
+
+            Fragment fragment{
+                static_cast<uint16_t>(x),
+                static_cast<uint16_t>(y),
+                sample.z,
+                Color(255, 255, 255),
+                // The visibility pass already rejected unlit samples; this only absorbs rounding
+                std::max(glm::dot(normal, L), 0.0f),
+                a.worldPos * w + b.worldPos * v + c.worldPos * u,
+                a.originalPos * w + b.originalPos * v + c.originalPos * u
+            };
+            shade(fragment, draw.objectType);
+            framebuffer.color[index] = fragment.color.toARGB();
+        }
+    });
+}